@@ -0,0 +1,48 @@
+/*
+ This is part of the OTF-Profiler. Copyright by ZIH, TU Dresden 2016-2018.
+ Authors: Maximillian Neumann, Denis Hünich, Jens Doleschal
+*/
+
+// CreateCube on a synthetic call tree with 1 and n threads, each run writes <output prefix>-<threads>
+// only the staging of the severities runs in parallel, set_sev and the write stay serial (Cube is not thread-safe)
+// usage: cube-fill-benchmark [cnodes] [locations] [locations per cnode, default: all] [threads] [output prefix]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "create_cube.h"
+#include "synthetic_data.h"
+
+using namespace std;
+
+int main(int argc, char** argv) {
+    uint64_t num_cnodes    = argc > 1 ? strtoull(argv[1], nullptr, 10) : 100000;
+    uint64_t num_locations = argc > 2 ? strtoull(argv[2], nullptr, 10) : 4096;
+    uint64_t per_cnode     = argc > 3 ? strtoull(argv[3], nullptr, 10) : num_locations;
+    uint32_t num_threads   = argc > 4 ? strtoul(argv[4], nullptr, 10) : 8;
+    string   prefix        = argc > 5 ? argv[5] : "cube-fill-benchmark";
+
+    AllData alldata;
+    build_synthetic(alldata, num_cnodes, num_locations, min(per_cnode, num_locations));
+
+    cout << num_cnodes << " cnodes, " << num_locations << " locations, " << min(per_cnode, num_locations)
+         << " locations per cnode" << endl;
+
+    for (uint32_t threads : {1u, num_threads}) {
+        alldata.params.num_threads        = threads;
+        alldata.params.output_file_prefix = prefix + "-" + to_string(threads);
+
+        auto start   = chrono::steady_clock::now();
+        auto written = CreateCube(alldata);
+        auto filled  = chrono::steady_clock::now();
+        written.get();
+        auto end = chrono::steady_clock::now();
+
+        cout << threads << " threads: fill " << chrono::duration<double>(filled - start).count() << " s, write "
+             << chrono::duration<double>(end - filled).count() << " s" << endl;
+    }
+
+    return 0;
+}
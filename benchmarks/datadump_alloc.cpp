@@ -0,0 +1,68 @@
+/*
+ This is part of the OTF-Profiler. Copyright by ZIH, TU Dresden 2016-2018.
+ Authors: Maximillian Neumann, Denis Hünich, Jens Doleschal
+*/
+
+// heap allocations of DataOut on a synthetic call tree, fails if they grow with the size of the profile
+// usage: datadump-alloc-benchmark [cnodes] [locations] [locations per cnode] [max allocations] [output prefix]
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+#include "data_out.h"
+#include "synthetic_data.h"
+
+using namespace std;
+
+static atomic<uint64_t> allocations{0};
+static atomic<uint64_t> allocated_bytes{0};
+
+void* operator new(size_t size) {
+    ++allocations;
+    allocated_bytes += size;
+
+    if (void* ptr = malloc(size != 0 ? size : 1))
+        return ptr;
+
+    throw bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+int main(int argc, char** argv) {
+    uint64_t num_cnodes      = argc > 1 ? strtoull(argv[1], nullptr, 10) : 100000;
+    uint64_t num_locations   = argc > 2 ? strtoull(argv[2], nullptr, 10) : 4096;
+    uint64_t per_cnode       = argc > 3 ? strtoull(argv[3], nullptr, 10) : 16;
+    uint64_t max_allocations = argc > 4 ? strtoull(argv[4], nullptr, 10) : 1000;
+    string   prefix          = argc > 5 ? argv[5] : "datadump-alloc-benchmark";
+
+    AllData alldata;
+    build_synthetic(alldata, num_cnodes, num_locations, min(per_cnode, num_locations));
+    alldata.params.output_file_prefix = prefix;
+
+    uint64_t allocations_before = allocations;
+    uint64_t bytes_before       = allocated_bytes;
+    auto     start              = chrono::steady_clock::now();
+
+    DataOut(alldata);
+
+    auto     end   = chrono::steady_clock::now();
+    uint64_t count = allocations - allocations_before;
+
+    cout << num_cnodes << " cnodes, " << num_locations << " locations: " << count << " allocations, "
+         << allocated_bytes - bytes_before << " bytes, " << chrono::duration<double>(end - start).count() << " s"
+         << endl;
+
+    if (count > max_allocations) {
+        cerr << "ERROR: DataOut made more than " << max_allocations << " allocations" << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+/*
+ This is part of the OTF-Profiler. Copyright by ZIH, TU Dresden 2016-2018.
+ Authors: Maximillian Neumann, Denis Hünich, Jens Doleschal
+*/
+
+#ifndef SYNTHETIC_DATA_H
+#define SYNTHETIC_DATA_H
+
+#include <string>
+#include <vector>
+
+#include "all_data.h"
+
+// profile of a synthetic trace for the benchmarks: num_cnodes call paths with data of per_cnode locations each
+inline void build_synthetic(AllData& alldata, uint64_t num_cnodes, uint64_t num_locations, uint64_t per_cnode) {
+    const uint64_t num_regions = 64;
+    const uint64_t fanout      = 8;
+
+    auto& defs = alldata.definitions;
+
+    alldata.metaData.timerResolution = 1000000000;
+
+    defs.paradigms.add(0, {"compiler"});
+    for (uint64_t r = 0; r < num_regions; ++r) {
+        auto name = defs.strings.intern("region_" + std::to_string(r));
+        defs.regions.add(r, {name, 0, 0, defs.strings.intern("")});
+    }
+
+    // machine -> node -> one process per 64 threads
+    defs.system_tree.insert_node("machine", 0, definitions::SystemClass::MACHINE, static_cast<uint32_t>(-1));
+    defs.system_tree.insert_node("node", 1, definitions::SystemClass::NODE, 0);
+    for (uint64_t l = 0; l < num_locations; ++l) {
+        if (l % 64 == 0)
+            defs.system_tree.insert_node("process " + std::to_string(l / 64), l / 64,
+                                         definitions::SystemClass::LOCATION_GROUP, 1);
+        defs.system_tree.insert_node("thread " + std::to_string(l), l, definitions::SystemClass::LOCATION, l / 64);
+    }
+
+    // location index like the readers set it -> node data turns dense once a node has data of enough locations
+    std::vector<uint64_t> location_ids(num_locations);
+    for (uint64_t l = 0; l < num_locations; ++l)
+        location_ids[l] = l;
+    alldata.call_path_tree.set_locations(location_ids);
+
+    // breadth first, fanout children per node, the locations of a node rotate over all locations
+    std::vector<tree_node*> nodes;
+    nodes.push_back(alldata.call_path_tree.insert_node(0, nullptr));
+    for (size_t parent = 0; nodes.size() < num_cnodes; ++parent)
+        for (uint64_t c = 0; c < fanout && nodes.size() < num_cnodes; ++c)
+            nodes.push_back(alldata.call_path_tree.insert_node((parent + c) % num_regions, nodes[parent]));
+
+    for (size_t i = 0; i < nodes.size(); ++i)
+        for (uint64_t l = 0; l < per_cnode; ++l)
+            nodes[i]->add_data((i * per_cnode + l) % num_locations, FunctionData{l + 1, 2 * (l + 1), l + 1});
+}
+
+#endif /* SYNTHETIC_DATA_H */
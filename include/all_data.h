@@ -8,6 +8,7 @@
 
 #include "data_tree.h"
 #include "definitions.h"
+#include "tree_summary.h"
 #include "utils.h"
 
 /* *** management and statistics data structures, needed on all ranks *** */
@@ -27,6 +28,9 @@ struct AllData {
     /* runtime measurement */
     TimeMeasurement tm;
 
+    /* statistics per call path for the summary outputs, indexed by tree_node::index */
+    std::shared_ptr<TreeSummary> summary;
+
     /* I/O summary */
     std::map<uint64_t, IoData> io_data;
     AllData(uint32_t my_rank = 0, uint32_t num_ranks = 1) {
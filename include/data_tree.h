@@ -7,36 +7,171 @@
 #define DATA_TREE_H
 
 #include "main_structs.h"
+#include "node_data.h"
 
-#include <deque>
 #include <memory>
-#include <tuple>
+#include <vector>
 
 class tree_iter;
 class tree_node;
 
+// storage of all nodes of a tree -> nodes are allocated block-wise, their addresses never change and they are
+// freed all at once together with the last copy of the tree (copies of a data_tree share the nodes)
+class node_arena {
+   public:
+    tree_node* create(uint64_t function_id, tree_node* parent);
+
+    // takes over all nodes of rhs, rhs is empty afterwards
+    void splice(node_arena& rhs);
+
+    size_t num_nodes() const;
+    size_t num_blocks() const { return blocks.size(); }
+    size_t allocated_bytes() const;
+
+   private:
+    struct block {
+        explicit block(size_t _capacity);
+        ~block();
+
+        block(const block&) = delete;
+        block& operator=(const block&) = delete;
+
+        // raw storage for capacity nodes, the first used ones are constructed
+        tree_node* storage;
+        size_t     capacity;
+        size_t     used = 0;
+    };
+
+    // the first blocks are small (temporary trees of reader threads and reduce), later ones grow up to max_block
+    static const size_t first_block = 64;
+    static const size_t max_block   = 8192;
+
+    std::vector<std::shared_ptr<block>> blocks;
+};
+
+// one node of the pre-order traversal index of a frozen tree
+struct traversal_entry {
+    tree_node* node;
+    size_t     parent;        // index of the parent, data_tree::npos for root nodes
+    size_t     subtree_size;  // nodes of the subtree including the node itself
+    uint32_t   depth;         // 0 for root nodes
+};
+
+/*
+Nodes and data of a tree as flat arrays of 64 bit values -> wire format of the MPI reduction, every section is sent
+as one contiguous array. Nodes are in pre-order, node ids are their positions, a parent comes before its children.
+A large tree is sent in chunks: every chunk continues the nodes of the previous one, its data may refer to nodes of
+earlier chunks.
+*/
+struct tree_payload {
+    static const uint64_t no_parent = static_cast<uint64_t>(-1);
+
+    // position of a chunked serialization
+    struct cursor {
+        size_t node      = 0;  // pre-order index of the next node
+        size_t row       = 0;  // next row of its node data
+        bool   node_sent = false;
+    };
+
+    struct node_entry {
+        uint64_t function_id;
+        uint64_t parent;  // id of the parent node, no_parent for root nodes
+    };
+
+    struct function_entry {
+        uint64_t     node;
+        uint64_t     location;
+        FunctionData data;
+    };
+
+    struct message_entry {
+        uint64_t    node;
+        uint64_t    location;
+        MessageData data;
+    };
+
+    struct collop_entry {
+        uint64_t   node;
+        uint64_t   location;
+        CollopData data;
+    };
+
+    struct metric_entry {
+        uint64_t         node;
+        uint64_t         location;
+        uint64_t         metric_id;
+        uint64_t         type;  // MetricDataType
+        MetricData::Data incl;
+        MetricData::Data excl;
+    };
+
+    std::vector<node_entry>     nodes;
+    std::vector<function_entry> functions;
+    std::vector<message_entry>  messages;
+    std::vector<collop_entry>   collops;
+    std::vector<metric_entry>   metrics;
+
+    void clear() {
+        nodes.clear();
+        functions.clear();
+        messages.clear();
+        collops.clear();
+        metrics.clear();
+    }
+
+    size_t bytes() const {
+        return nodes.size() * sizeof(node_entry) + functions.size() * sizeof(function_entry) +
+               messages.size() * sizeof(message_entry) + collops.size() * sizeof(collop_entry) +
+               metrics.size() * sizeof(metric_entry);
+    }
+};
+
 class data_tree {
    public:
+    static const size_t npos = static_cast<size_t>(-1);
+
     data_tree();
 
-    data_tree(std::map<uint64_t, std::tuple<uint64_t, uint64_t, std::shared_ptr<tree_node>>>& mapping);
+    // dense per-location data of the nodes needs the final set of locations -> set before the first node is added
+    void set_locations(const std::vector<uint64_t>& location_ids);
+    void set_locations(std::shared_ptr<const LocationIndex> locations) { location_index = locations; }
+
+    std::shared_ptr<const LocationIndex> locations() const { return location_index; }
+
+    // slots of the synchronous metrics -> set by the reader after the definitions, before the first node is added
+    void set_metric_layout(std::shared_ptr<const MetricLayout> layout) { metric_layout_ = layout; }
 
-    tree_node*                 insert_node(uint64_t function_id, tree_node* parent);
-    std::shared_ptr<tree_node> insert_node(uint64_t function_id, std::shared_ptr<tree_node> parent);
-    void                       insert_node(std::shared_ptr<tree_node> aNode);
+    std::shared_ptr<const MetricLayout> metric_layout() const { return metric_layout_; }
 
+    tree_node* insert_node(uint64_t function_id, tree_node* parent);
+
+    // moves all nodes of rhs_tree into this tree, rhs_tree is empty afterwards
     void merge_tree(data_tree& rhs_tree);
-    void insert_sub_tree(std::shared_ptr<tree_node>& parent, std::shared_ptr<tree_node>& n_node);
+    void insert_sub_tree(tree_node* parent, tree_node* n_node);
 
-    /* map< node,parent > */  // mapping darf !NICHT! unordered sein -> Reihenfolge ist wichtig!
-    void serialize_data(std::map<uint64_t, std::pair<uint64_t, uint64_t>>&                 mapping,
-                        std::deque<std::tuple<uint64_t, uint64_t, FunctionData*>>&         f_data,
-                        std::deque<std::tuple<uint64_t, uint64_t, MessageData*>>&          m_data,
-                        std::deque<std::tuple<uint64_t, uint64_t, CollopData*>>&           c_data,
-                        std::deque<std::tuple<uint64_t, uint64_t, uint64_t, MetricData*>>& met_data);
+    // fills payload with the nodes and data behind position until it holds about max_bytes (at least one row),
+    // returns false once the whole tree is serialized
+    bool serialize_data(tree_payload& payload, tree_payload::cursor& position, size_t max_bytes);
+    // adds the nodes and data of a received chunk, nodes maps the node ids of all chunks so far to their nodes
+    void deserialize_data(const tree_payload& payload, std::vector<tree_node*>& nodes);
 
     /* functionId , node* */
-    std::map<uint64_t, std::shared_ptr<tree_node>> root_nodes;
+    std::map<uint64_t, tree_node*> root_nodes;
+
+    // builds the pre-order traversal index -> call once the tree is complete (after reading and reduce), every
+    // change of the tree drops the index again
+    void freeze();
+    bool frozen() const { return is_frozen; }
+
+    // pre-order index of a frozen tree, tree_node::index is the position of a node
+    const std::vector<traversal_entry>& traversal() const { return order; }
+    // index behind the subtree of the node at index i -> [i, subtree_end(i)) is the subtree
+    size_t subtree_end(size_t i) const { return i + order[i].subtree_size; }
+
+    size_t num_nodes() const { return nodes.num_nodes(); }
+    size_t allocated_bytes() const { return nodes.allocated_bytes(); }
+    // storage of the per-location data of all reachable nodes
+    size_t node_data_bytes();
 
     /* <rank, data> */
 
@@ -46,7 +181,25 @@ class data_tree {
     tree_iter end();
 
    private:
-    void merge_node(std::shared_ptr<tree_node>& lhs_node, std::shared_ptr<tree_node>& rhs_node);
+    friend class tree_iter;
+
+    void merge_node(tree_node* lhs_node, tree_node* rhs_node);
+
+    void thaw() {
+        is_frozen = false;
+        order.clear();
+    }
+
+    node_arena nodes;
+
+    bool                         is_frozen = false;
+    std::vector<traversal_entry> order;
+
+    std::shared_ptr<const LocationIndex> location_index;
+    std::shared_ptr<const MetricLayout>  metric_layout_;
+    // indices and layouts of merged trees, still used by their nodes
+    std::vector<std::shared_ptr<const LocationIndex>> merged_indices;
+    std::vector<std::shared_ptr<const MetricLayout>>  merged_layouts;
 };
 
 class tree_node {
@@ -57,8 +210,6 @@ class tree_node {
     // -> ist für circos wenn überhaupt wichtig -> links von x zu y usw.
    public:
     tree_node(const uint64_t _function_id, tree_node* _parent);
-    tree_node(const uint64_t _function_id, const std::shared_ptr<tree_node>& _parent);
-    tree_node(const uint64_t _function_id, const std::shared_ptr<tree_node>& _parent, const uint64_t process_num);
     tree_node(const uint64_t _function_id);
 
     ~tree_node();
@@ -68,33 +219,38 @@ class tree_node {
     void add_data(const uint64_t location_id, const CollopData& cdata);
     void add_data(const uint64_t location_id, const uint64_t metric_id, const MetricData& metdata);
 
+    // metric data of a location, created with zero values if it does not exist yet -> metrics without a slot
+    MetricData& metric(const uint64_t location_id, const uint64_t metric_id, MetricDataType type);
+
+    // applies the metric sample recorded before an enter (subtract) or leave (add) of this node, the parent gets the
+    // inverse on its exclusive values
+    void add_metric_sample(const uint64_t location_id, const MetricSample& sample, bool add);
+
     // std::shared_ptr<tree_node> parent;
     tree_node* parent;
 
     uint64_t function_id;
 
-    /* function_id, pointer to node */
-    std::map<uint64_t, std::shared_ptr<tree_node>> children;
+    /* function_id, pointer to node -> owned by the node_arena of the tree */
+    std::map<uint64_t, tree_node*> children;
 
     /* data containers */
-    /* maps with location id as key -> value = NodeData -> function, p2p or collop */
-    std::map<uint64_t, NodeData> node_data;
+    /* per location: function, p2p, collop and metric data */
+    NodeDataTable node_data;
+
+    // position in the traversal index, only valid while the tree is frozen
+    size_t index = data_tree::npos;
 
-    std::map<uint64_t, MessageData*> have_message;  // TODO raus damit -> sinnlos und fehleranfällig
-    std::map<uint64_t, CollopData*>  have_collop;   // TODO raus damit -> sinnlos und fehleranfällig
     // TODO workaround
     //--->TODO funktion implementieren die aus node_data heraus findet ob collop bzw p2p da ist -> umständlich
     bool has_p2p    = false;
     bool has_collop = false;
-
-    uint64_t  last_loc;
-    NodeData* last_data;
 };
 
 class tree_iter {
    public:
     tree_iter(data_tree& _tree) {
-        node_ptr = _tree.root_nodes.begin()->second.get();
+        node_ptr = _tree.root_nodes.begin()->second;
         tree_ptr = &_tree;
     };
 
@@ -115,8 +271,22 @@ class tree_iter {
     tree_iter& operator++() {
         assert((node_ptr != nullptr) || (tree_ptr != nullptr));
 
+        // frozen tree -> next node of the pre-order index
+        if (tree_ptr->is_frozen) {
+            size_t next = node_ptr->index + 1;
+
+            if (next < tree_ptr->order.size()) {
+                node_ptr = tree_ptr->order[next].node;
+            } else {
+                node_ptr = nullptr;
+                tree_ptr = nullptr;
+            }
+
+            return *this;
+        }
+
         if (!node_ptr->children.empty()) {
-            node_ptr = node_ptr->children.begin()->second.get();
+            node_ptr = node_ptr->children.begin()->second;
 
         } else {
             while (true) {
@@ -131,7 +301,7 @@ class tree_iter {
                         continue;
                     }
 
-                    node_ptr = child_it->second.get();
+                    node_ptr = child_it->second;
 
                     break;
 
@@ -141,7 +311,7 @@ class tree_iter {
                     ++child_it;
 
                     if (child_it != tree_ptr->root_nodes.end()) {
-                        node_ptr = child_it->second.get();
+                        node_ptr = child_it->second;
 
                     } else {
                         node_ptr = nullptr;
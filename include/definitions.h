@@ -6,7 +6,9 @@
 #ifndef DEFINITIONS_H
 #define DEFINITIONS_H
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <map>
 #include <memory>
 #include <set>
@@ -20,24 +22,68 @@ namespace definitions {
 
 using paradigm_id_t = uint32_t;
 
+// position of a string in the StringTable of the definitions, 0 -> empty string
+struct StringRef {
+    uint64_t offset;
+};
+
+/*
+Arena of all definition strings: every distinct string is stored once, NUL terminated, in one character array.
+The definitions keep StringRefs instead of std::strings, the characters are looked up when they are written out.
+Pointers returned by operator[] are valid until the next intern().
+*/
+class StringTable {
+   public:
+    StringTable();
+    StringTable(const StringTable& other);
+    StringTable& operator=(const StringTable& other);
+
+    StringRef intern(const char* string, size_t length);
+    StringRef intern(const char* string) { return intern(string, std::strlen(string)); }
+    StringRef intern(const std::string& string) { return intern(string.data(), string.size()); }
+
+    const char* operator[](StringRef ref) const { return chars.data() + ref.offset; }
+
+    std::string str(StringRef ref) const { return std::string(chars.data() + ref.offset); }
+
+    // number of distinct strings and bytes of the arena
+    size_t size() const { return lookup.size(); }
+    size_t bytes() const { return chars.size(); }
+
+   private:
+    // hash and compare the strings at the offsets in the arena
+    struct Hash {
+        const StringTable* table;
+        size_t             operator()(uint64_t offset) const;
+    };
+
+    struct Equal {
+        const StringTable* table;
+        bool operator()(uint64_t lhs, uint64_t rhs) const { return std::strcmp((*table)[{lhs}], (*table)[{rhs}]) == 0; }
+    };
+
+    std::vector<char>                         chars;
+    std::unordered_set<uint64_t, Hash, Equal> lookup;
+};
+
 struct Region {
-    std::string   name;
+    StringRef     name;
     paradigm_id_t paradigm_id;
     uint32_t      source_line;
-    std::string   file_name;
+    StringRef     file_name;
 };
 
 /*OTF2 Metric */
 
 struct Metric {
-    std::string     name;
-    std::string     description;
+    StringRef       name;
+    StringRef       description;
     MetricType      metricType;     // PAPI, etc.
     MetricMode      metricMode;     // accumulative, relative, etc.
     MetricDataType  type;           // OTF2_TYPE_INT64, OTF2_TYPE_UINT64, OTF2_TYPE_DOUBLE
     MetricBase      base;           // binary or decimal
     int64_t         exponent;       // Metric value scaled by factor base^exponent to get value in its base unit
-    std::string     unit;           // "bytes", "operations", or "seconds"
+    StringRef       unit;           // "bytes", "operations", or "seconds"
     bool            allowed;        // ?
 };
 
@@ -60,32 +106,146 @@ struct Group {
     std::vector<uint64_t> members;
 };
 
+/*
+Definitions of one type, indexed by their id. Trace ids are usually dense small integers -> they are kept in a vector
+indexed by the id. An id far beyond the defined ones goes to a map, it is moved to the vector once that reaches it.
+get_all() iterates in ascending id order and yields <id, properties> pairs.
+Pointers returned by get() are valid until the next add().
+*/
 template <typename Id, typename TypeProperties>
 class DefinitionType {
    public:
-    using ContainerTypeProps_t = std::map<Id, TypeProperties>;
     using TypeProperties_t     = TypeProperties;
+    using ContainerTypeProps_t = std::map<Id, TypeProperties>;
+    using value_type           = std::pair<Id, const TypeProperties&>;
+
+    class const_iterator {
+       public:
+        const_iterator(const DefinitionType* _defs, size_t _pos, typename ContainerTypeProps_t::const_iterator _sparse)
+            : defs(_defs), pos(_pos), sparse(_sparse) {
+            skip_undefined();
+        }
+
+        value_type operator*() const {
+            if (pos < defs->dense.size())
+                return value_type(static_cast<Id>(pos), defs->dense[pos]);
+
+            return value_type(sparse->first, sparse->second);
+        }
+
+        const_iterator& operator++() {
+            if (pos < defs->dense.size()) {
+                ++pos;
+                skip_undefined();
+            } else
+                ++sparse;
+
+            return *this;
+        }
+
+        bool operator==(const const_iterator& rhs) const { return pos == rhs.pos && sparse == rhs.sparse; }
+        bool operator!=(const const_iterator& rhs) const { return !(*this == rhs); }
+
+       private:
+        void skip_undefined() {
+            while (pos < defs->dense.size() && !defs->defined[pos])
+                ++pos;
+        }
+
+        const DefinitionType*                         defs;
+        size_t                                        pos;
+        typename ContainerTypeProps_t::const_iterator sparse;
+    };
+
+    // range of all definitions
+    class Range {
+       public:
+        explicit Range(const DefinitionType* _defs) : defs(_defs) {}
+
+        const_iterator begin() const { return const_iterator(defs, 0, defs->sparse.begin()); }
+        const_iterator end() const { return const_iterator(defs, defs->dense.size(), defs->sparse.end()); }
+
+        size_t size() const { return defs->num; }
+        bool   empty() const { return defs->num == 0; }
+
+       private:
+        const DefinitionType* defs;
+    };
 
     DefinitionType() = default;
 
-    DefinitionType(const ContainerTypeProps_t& props) : all_properties(props) {}
+    DefinitionType(const ContainerTypeProps_t& props) {
+        for (const auto& prop : props)
+            add(prop.first, prop.second);
+    }
+
+    void add(Id id, const TypeProperties_t& props) {
+        auto index = static_cast<uint64_t>(id);
 
-    void add(Id id, const TypeProperties_t& props) { all_properties[id] = props; }
+        if (index >= dense.size() && index < dense_limit())
+            grow(index + 1);
+
+        if (index < dense.size()) {
+            if (!defined[index]) {
+                defined[index] = true;
+                ++num;
+            }
+
+            dense[index] = props;
+            return;
+        }
+
+        auto it = sparse.find(id);
+        if (it == sparse.end()) {
+            sparse.insert(std::make_pair(id, props));
+            ++num;
+        } else
+            it->second = props;
+    }
 
     const TypeProperties_t* get(Id id) const {
-        const auto props_it = all_properties.find(id);
+        auto index = static_cast<uint64_t>(id);
 
-        if (props_it == all_properties.end())
+        if (index < dense.size())
+            return defined[index] ? &dense[index] : nullptr;
+
+        const auto props_it = sparse.find(id);
+
+        if (props_it == sparse.end())
             // TODO Error handling
             return nullptr;
 
         return &(props_it->second);
     }
 
-    const ContainerTypeProps_t& get_all() const { return all_properties; }
+    Range get_all() const { return Range(this); }
+
+    size_t size() const { return num; }
 
    private:
-    ContainerTypeProps_t all_properties;
+    // ids up to twice the number of definitions (at least 1024) are kept in the vector
+    uint64_t dense_limit() const { return std::max<uint64_t>(2 * static_cast<uint64_t>(num), 1024); }
+
+    // resizes the vector and moves the ids it now covers from the map
+    void grow(uint64_t new_size) {
+        new_size = std::max<uint64_t>(new_size, 2 * dense.size());
+        new_size = std::min<uint64_t>(new_size, std::max<uint64_t>(dense_limit(), dense.size() + 1));
+
+        dense.resize(new_size);
+        defined.resize(new_size, false);
+
+        auto last = sparse.begin();
+        for (; last != sparse.end() && static_cast<uint64_t>(last->first) < new_size; ++last) {
+            dense[static_cast<uint64_t>(last->first)]   = last->second;
+            defined[static_cast<uint64_t>(last->first)] = true;
+        }
+        sparse.erase(sparse.begin(), last);
+    }
+
+    std::vector<TypeProperties> dense;
+    std::vector<bool>           defined;
+    ContainerTypeProps_t        sparse;
+    size_t                      num = 0;
 };
 
 enum class SystemClass : uint8_t {
@@ -251,6 +411,11 @@ class SystemTree {
         return std::make_pair(0, nullptr);
     }
 
+    // copy without the nodes deeper than level, location(id) returns the ancestor of the location at level
+    std::unique_ptr<SystemTree> reduced(uint32_t level) const {
+        return std::unique_ptr<SystemTree>(copy_reduced(*this, level));
+    }
+
     const std::shared_ptr<SystemNode_t> get_root() const { return root; }
 
     const size_t num_level() const { return num_nodes_per_level.size(); }
@@ -267,12 +432,30 @@ class SystemTree {
         return nullptr;
     }
 
+    SystemNode_t* location_group(size_t group_id) {
+        if (group_id < location_grps.size())
+            return location_grps[group_id];
+
+        return nullptr;
+    }
+
+    // ids of all locations in ascending order
+    std::vector<uint64_t> location_ids() const {
+        std::vector<uint64_t> ids;
+        ids.reserve(locations.size());
+
+        for (const auto& location : locations)
+            ids.push_back(location.first);
+
+        return ids;
+    }
+
     iterator begin() const;
 
     iterator end() const;
 
    private:
-    SystemTree* copy_reduced(const SystemTree& sys_tree, uint32_t level);
+    static SystemTree* copy_reduced(const SystemTree& sys_tree, uint32_t level);
 
    private:
     std::shared_ptr<SystemNode_t>     root;
@@ -370,7 +553,7 @@ class SystemIterator {
 };
 
 struct IoHandle {
-    std::string name;
+    StringRef   name;
     uint32_t    io_paradigm;
     uint64_t    file;
     uint64_t    parent;
@@ -380,6 +563,7 @@ struct IoHandle {
 };
 
 struct Definitions {
+    StringTable                             strings;
     DefinitionType<uint64_t, Region>        regions;
     DefinitionType<uint64_t, Metric>        metrics;
     DefinitionType<uint64_t, Metric_Class>  metric_classes;
@@ -407,52 +591,7 @@ struct meta_data {
     uint32_t myRank;
     uint32_t numRanks;
 
-#ifdef OTFPROFILER_MPI
-
-    uint32_t packBufferSize;
-    char*    packBuffer;
-
-#endif
-
-    meta_data(uint32_t my_rank = 0, uint32_t num_ranks = 1) : myRank(my_rank), numRanks(num_ranks), timerResolution(0) {
-#ifdef OTFPROFILER_MPI
-
-        packBufferSize = 0;
-        packBuffer     = NULL;
-
-#endif
-    }
-
-    ~meta_data() {
-#ifdef OTFPROFILER_MPI
-
-        freePackBuffer();
-
-#endif
-    }
-
-#ifdef OTFPROFILER_MPI
-    char* guaranteePackBuffer(uint32_t size) {
-        if (packBufferSize < size) {
-            packBufferSize = size;
-            packBuffer     = (char*)realloc(packBuffer, packBufferSize * sizeof(char));
-
-            assert(NULL != packBuffer);
-        }
-
-        return packBuffer;
-    }
-
-    void freePackBuffer() {
-        if (packBuffer) {
-            free(packBuffer);
-            packBuffer = NULL;
-        }
-    }
-
-    char* getPackBuffer() { return packBuffer; }
-
-#endif /* OTFPROFILER_MPI */
+    meta_data(uint32_t my_rank = 0, uint32_t num_ranks = 1) : myRank(my_rank), numRanks(num_ranks), timerResolution(0) {}
 };
 
 #endif  // DEFINITIONS_H
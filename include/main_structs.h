@@ -26,7 +26,8 @@ enum class MetricMode : uint8_t {
     ABSOLUTE_NEXT,
     RELATIVE_POINT,
     RELATIVE_LAST,
-    RELATIVE_NEXT
+    RELATIVE_NEXT,
+    ACCUMULATED_START
 };
 
 enum class MetricType : uint8_t {
@@ -276,27 +277,21 @@ struct RmaData {
     }
 };
 
-struct NodeData {
-    FunctionData f_data;
-    MessageData  m_data;
-    CollopData   c_data;
-
-    std::map<uint64_t, MetricData> metrics;
-    NodeData() : f_data(), m_data(), c_data() {}
-
-    NodeData(const FunctionData& _f_data) : f_data(_f_data), m_data(), c_data() {}
-
-    NodeData(const MessageData& _m_data) : f_data(), m_data(_m_data), c_data() {}
-
-    NodeData(const CollopData& _c_data) : f_data(), m_data(), c_data(_c_data) {}
-};
-
 struct IoData {
     uint64_t num_operations;
     uint64_t num_bytes;
     uint64_t transfer_time;
     uint64_t nontransfer_time;
     IoData() : num_operations(0), num_bytes(0), transfer_time(0), nontransfer_time(0) {}
+
+    IoData& operator+=(const IoData& rhs) {
+        num_operations += rhs.num_operations;
+        num_bytes += rhs.num_bytes;
+        transfer_time += rhs.transfer_time;
+        nontransfer_time += rhs.nontransfer_time;
+
+        return *this;
+    }
 };
 
 #endif
@@ -0,0 +1,176 @@
+/*
+ This is part of the OTF-Profiler. Copyright by ZIH, TU Dresden 2016-2018.
+ Authors: Maximillian Neumann, Denis Hünich, Jens Doleschal
+*/
+
+#ifndef METRIC_SLOTS_H
+#define METRIC_SLOTS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "main_structs.h"
+
+// value type of a slot array
+template <typename T>
+struct metric_slot_type;
+
+template <>
+struct metric_slot_type<uint64_t> {
+    static const MetricDataType type = MetricDataType::UINT64;
+};
+
+template <>
+struct metric_slot_type<int64_t> {
+    static const MetricDataType type = MetricDataType::INT64;
+};
+
+template <>
+struct metric_slot_type<double> {
+    static const MetricDataType type = MetricDataType::DOUBLE;
+};
+
+inline size_t metric_type_index(MetricDataType type) { return static_cast<size_t>(type); }
+
+// accumulation kernels for one slot range -> plain loops over contiguous arrays of one type, vectorized by the compiler
+namespace metric_kernel {
+
+template <typename T>
+inline void add(T* dst, const T* src, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        dst[i] += src[i];
+}
+
+template <typename T>
+inline void sub(T* dst, const T* src, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        dst[i] -= src[i];
+}
+
+}  // namespace metric_kernel
+
+/*
+Slots of the synchronous metrics, resolved once after the definitions:
+    every metric gets a slot in the array of its value type (uint64_t, int64_t or double)
+    every metric class knows the slots of its members -> a metric event is copied into the slots without lookups
+The members of a class are usually added one after the other, their slots of one type are then one contiguous range.
+*/
+class MetricLayout {
+   public:
+    // slots of one value type of a metric class
+    struct Members {
+        std::vector<uint32_t> slots;
+        std::vector<uint8_t>  positions;  // position of the value in the metric event
+        bool                  contiguous = true;
+    };
+
+    struct Class {
+        bool    defined = false;
+        Members members[3];  // per MetricDataType
+
+        template <typename T>
+        const Members& of() const {
+            return members[metric_type_index(metric_slot_type<T>::type)];
+        }
+    };
+
+    // slot of a metric, added if it has none yet
+    uint32_t add_metric(uint64_t metric_id, MetricDataType type);
+    // <position in the event, metric id> -> the metrics must have been added
+    void add_class(uint64_t class_id, const std::vector<std::pair<uint8_t, uint64_t>>& members);
+
+    const Class* metric_class(uint64_t class_id) const {
+        return class_id < classes.size() && classes[class_id].defined ? &classes[class_id] : nullptr;
+    }
+
+    bool find(uint64_t metric_id, MetricDataType& type, uint32_t& slot) const;
+
+    size_t width(MetricDataType type) const { return slot_metric[metric_type_index(type)].size(); }
+    size_t num_slots() const {
+        return width(MetricDataType::UINT64) + width(MetricDataType::INT64) + width(MetricDataType::DOUBLE);
+    }
+    // position of the first slot of a type if the slots of all types are numbered one after the other
+    size_t offset(MetricDataType type) const {
+        size_t offset = 0;
+        for (size_t t = 0; t < metric_type_index(type); ++t)
+            offset += slot_metric[t].size();
+
+        return offset;
+    }
+    size_t num_classes() const { return num_defined; }
+    bool   empty() const { return num_slots() == 0; }
+
+    uint64_t metric_id(MetricDataType type, uint32_t slot) const { return slot_metric[metric_type_index(type)][slot]; }
+
+   private:
+    struct SlotRef {
+        MetricDataType type;
+        uint32_t       slot;
+    };
+
+    std::vector<uint64_t>                 slot_metric[3];
+    std::unordered_map<uint64_t, SlotRef> metric_slots;
+    // indexed by the (dense) metric class id
+    std::vector<Class> classes;
+    size_t             num_defined = 0;
+};
+
+// metric values of one location recorded since its last enter/leave, one value per slot
+class MetricSample {
+   public:
+    void reset(const MetricLayout& layout) {
+        u.assign(layout.width(MetricDataType::UINT64), 0);
+        s.assign(layout.width(MetricDataType::INT64), 0);
+        d.assign(layout.width(MetricDataType::DOUBLE), 0);
+        recorded.clear();
+    }
+
+    template <typename T>
+    std::vector<T>& values();
+
+    template <typename T>
+    const std::vector<T>& values() const {
+        return const_cast<MetricSample*>(this)->values<T>();
+    }
+
+    void record(const MetricLayout::Class* metric_class) {
+        for (auto* c : recorded)
+            if (c == metric_class)
+                return;
+
+        recorded.push_back(metric_class);
+    }
+
+    // classes recorded since the last enter/leave
+    const std::vector<const MetricLayout::Class*>& classes() const { return recorded; }
+
+    bool empty() const { return recorded.empty(); }
+    void clear() { recorded.clear(); }
+
+   private:
+    std::vector<uint64_t> u;
+    std::vector<int64_t>  s;
+    std::vector<double>   d;
+
+    std::vector<const MetricLayout::Class*> recorded;
+};
+
+template <>
+inline std::vector<uint64_t>& MetricSample::values<uint64_t>() {
+    return u;
+}
+
+template <>
+inline std::vector<int64_t>& MetricSample::values<int64_t>() {
+    return s;
+}
+
+template <>
+inline std::vector<double>& MetricSample::values<double>() {
+    return d;
+}
+
+#endif /* METRIC_SLOTS_H */
@@ -0,0 +1,298 @@
+/*
+ This is part of the OTF-Profiler. Copyright by ZIH, TU Dresden 2016-2018.
+ Authors: Maximillian Neumann, Denis Hünich, Jens Doleschal
+*/
+
+#ifndef NODE_DATA_H
+#define NODE_DATA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "main_structs.h"
+#include "metric_slots.h"
+
+// maps the location ids of a trace to dense indices 0..n-1 -> built once from the system tree after the definitions
+class LocationIndex {
+   public:
+    static const uint32_t npos = static_cast<uint32_t>(-1);
+
+    explicit LocationIndex(std::vector<uint64_t> location_ids);
+
+    uint32_t index(uint64_t location_id) const {
+        if (identity)
+            return location_id < ids.size() ? static_cast<uint32_t>(location_id) : npos;
+
+        auto it = indices.find(location_id);
+        return it != indices.end() ? it->second : npos;
+    }
+
+    uint64_t location(uint32_t index) const { return ids[index]; }
+
+    size_t size() const { return ids.size(); }
+
+   private:
+    // sorted -> dense rows are iterated in the order of the location ids
+    std::vector<uint64_t> ids;
+    // empty if the location ids are 0..n-1 (usual for OTF2)
+    std::unordered_map<uint64_t, uint32_t> indices;
+    bool                                   identity = true;
+};
+
+/*
+Data of one call path node per location, stored column-wise (struct of arrays).
+    sparse: one row per location with data, rows sorted by location id
+    dense:  one row per location of the LocationIndex, used as soon as half of all locations have data
+Message, collop and metric columns are only allocated if the node has such data at all.
+Metrics of the MetricLayout are kept in slot arrays per value type (row-major, one row after the other), samples are
+applied with the kernels of metric_slots.h. Other metrics (OTF, json, reduce) use one MetricData column per metric.
+
+Iterating the table yields the locations with data in ascending order:
+    for (const auto& data : node->node_data)
+        data.first -> location id, data.second.f_data/m_data/c_data, data.second.metrics -> <metric id, MetricData>
+    (metrics are returned by value)
+*/
+class NodeDataTable {
+   public:
+    static const size_t npos = static_cast<size_t>(-1);
+
+    // metrics of one row, iterates over <metric id, MetricData> pairs like a map -> first the MetricData columns, then
+    // the slots
+    class MetricsView {
+       public:
+        class iterator {
+           public:
+            iterator(const NodeDataTable* _table, size_t _row, size_t _column)
+                : table(_table), row(_row), column(_column) {
+                skip();
+            }
+
+            std::pair<uint64_t, MetricData> operator*() const {
+                if (column < table->metric_columns.size()) {
+                    const auto& c = table->metric_columns[column];
+                    return {c.metric_id, c.data[row]};
+                }
+
+                return table->slot_metric(row, column - table->metric_columns.size());
+            }
+
+            iterator& operator++() {
+                ++column;
+                skip();
+                return *this;
+            }
+
+            bool operator!=(const iterator& rhs) const { return column != rhs.column; }
+            bool operator==(const iterator& rhs) const { return column == rhs.column; }
+
+           private:
+            void skip() {
+                while (column < table->metric_columns.size() && !table->metric_columns[column].present[row])
+                    ++column;
+
+                if (column < table->metric_columns.size())
+                    return;
+
+                auto slots = table->num_slots();
+                while (column < table->metric_columns.size() + slots &&
+                       !table->slot_present[row * slots + column - table->metric_columns.size()])
+                    ++column;
+            }
+
+            const NodeDataTable* table;
+            size_t               row;
+            size_t               column;
+        };
+
+        MetricsView(const NodeDataTable* _table, size_t _row) : table(_table), row(_row) {}
+
+        iterator begin() const { return iterator(table, row, 0); }
+        iterator end() const { return iterator(table, row, table->metric_columns.size() + table->num_slots()); }
+
+        bool empty() const { return !(begin() != end()); }
+
+       private:
+        const NodeDataTable* table;
+        size_t               row;
+    };
+
+    struct Row {
+        const FunctionData& f_data;
+        const MessageData&  m_data;
+        const CollopData&   c_data;
+        MetricsView         metrics;
+    };
+
+    struct Entry {
+        uint64_t first;
+        Row      second;
+        size_t   row;
+    };
+
+    class const_iterator {
+       public:
+        const_iterator(const NodeDataTable* _table, size_t _row) : table(_table), row(_row) { skip(); }
+
+        Entry operator*() const { return table->entry(row); }
+
+        const_iterator& operator++() {
+            ++row;
+            skip();
+            return *this;
+        }
+
+        bool operator!=(const const_iterator& rhs) const { return row != rhs.row; }
+        bool operator==(const const_iterator& rhs) const { return row == rhs.row; }
+
+       private:
+        void skip() {
+            if (table->dense)
+                while (row < table->f.size() && !table->present[row])
+                    ++row;
+        }
+
+        const NodeDataTable* table;
+        size_t               row;
+    };
+
+    NodeDataTable() = default;
+
+    // without an index the table stays sparse
+    void set_index(const LocationIndex* _index) { index = _index; }
+    // without a layout all metrics are stored as MetricData columns
+    void set_layout(const MetricLayout* _layout) { layout = _layout; }
+
+    // number of locations with data
+    size_t size() const { return dense ? num_dense : row_location.size(); }
+    bool   empty() const { return size() == 0; }
+    bool   is_dense() const { return dense; }
+
+    // row of a location, npos if it has no data
+    size_t find(uint64_t location_id) const;
+    // row of a location, created if it has no data yet -> other row numbers may change
+    size_t row(uint64_t location_id);
+
+    FunctionData& f_data(size_t row) { return f[row]; }
+
+    MessageData& m_data(size_t row) {
+        if (m.empty())
+            m.resize(f.size(), MessageData{});
+        return m[row];
+    }
+
+    CollopData& c_data(size_t row) {
+        if (c.empty())
+            c.resize(f.size(), CollopData{});
+        return c[row];
+    }
+
+    // MetricData column of a metric -> only for metrics that are not part of the layout
+    MetricData& metric(size_t row, uint64_t metric_id, MetricDataType type);
+    // sets the values of a metric, in its slot if the metric is part of the layout
+    void set_metric(size_t row, uint64_t metric_id, const MetricData& metdata);
+
+    // applies the recorded classes of a sample (layout of the table) to inclusive and exclusive values or only to the
+    // exclusive values (parent node), add or subtract
+    void add_sample(size_t row, const MetricSample& sample, bool add, bool inclusive);
+
+    // copies the rows of rhs whose location has no row here yet (like std::map::insert)
+    void merge(const NodeDataTable& rhs);
+    // like merge(const&), but takes over the rows of rhs if this table is empty -> rhs is empty and released after
+    void merge(NodeDataTable&& rhs);
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, f.size()); }
+
+    size_t allocated_bytes() const;
+
+   private:
+    struct MetricColumn {
+        uint64_t                metric_id;
+        std::vector<MetricData> data;
+        std::vector<bool>       present;
+    };
+
+    Entry entry(size_t row) const;
+
+    template <typename T>
+    struct SlotColumn {
+        std::vector<T> incl;
+        std::vector<T> excl;
+    };
+
+    template <typename T>
+    SlotColumn<T>& slots();
+    template <typename T>
+    const SlotColumn<T>& slots() const {
+        return const_cast<NodeDataTable*>(this)->slots<T>();
+    }
+
+    template <typename T>
+    void apply_sample(size_t row, const MetricSample& sample, const MetricLayout::Class& metric_class, bool add,
+                      bool inclusive);
+    template <typename T>
+    void insert_slots(size_t pos);
+    template <typename T>
+    void copy_slots(const NodeDataTable& src, size_t src_row, size_t dst_row);
+
+    size_t num_slots() const { return slot_present.empty() ? 0 : layout->num_slots(); }
+    void   allocate_slots();
+    // slot in the numbering of MetricLayout::offset
+    std::pair<uint64_t, MetricData> slot_metric(size_t row, size_t slot) const;
+
+    void insert_row(size_t pos, uint64_t location_id);
+    void copy_row(const NodeDataTable& src, size_t src_row, size_t dst_row);
+    bool make_dense();
+    void make_sparse();
+
+    size_t dense_threshold() const { return index->size() / 2; }
+
+    const LocationIndex* index  = nullptr;
+    const MetricLayout*  layout = nullptr;
+    bool                 dense  = false;
+
+    // sparse: location id of every row
+    std::vector<uint64_t> row_location;
+    // dense: rows with data
+    std::vector<bool> present;
+    size_t            num_dense = 0;
+
+    std::vector<FunctionData> f;
+    std::vector<MessageData>  m;  // empty or one entry per row
+    std::vector<CollopData>   c;  // empty or one entry per row
+    std::vector<MetricColumn> metric_columns;
+
+    // empty or layout->width(type) entries per row
+    SlotColumn<uint64_t> slots_u;
+    SlotColumn<int64_t>  slots_s;
+    SlotColumn<double>   slots_d;
+    // empty or layout->num_slots() entries per row
+    std::vector<bool> slot_present;
+
+    // repeated access of the same location (events are read location by location)
+    uint64_t last_location = static_cast<uint64_t>(-1);
+    size_t   last_row      = npos;
+
+    static const MessageData no_messages;
+    static const CollopData  no_collops;
+};
+
+template <>
+inline NodeDataTable::SlotColumn<uint64_t>& NodeDataTable::slots<uint64_t>() {
+    return slots_u;
+}
+
+template <>
+inline NodeDataTable::SlotColumn<int64_t>& NodeDataTable::slots<int64_t>() {
+    return slots_s;
+}
+
+template <>
+inline NodeDataTable::SlotColumn<double>& NodeDataTable::slots<double>() {
+    return slots_d;
+}
+
+#endif /* NODE_DATA_H */
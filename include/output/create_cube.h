@@ -6,8 +6,11 @@
 #ifndef CREATE_CUBE_H
 #define CREATE_CUBE_H
 
+#include <future>
+
 #include "all_data.h"
 
-bool CreateCube(AllData& alldata);
+/* builds the cube of rank 0 and writes it in the background -> get() the result before the profile is finished */
+std::future<bool> CreateCube(AllData& alldata);
 
 #endif
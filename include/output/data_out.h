@@ -1,7 +1,7 @@
 /*
 Reads all data( call_path_tree, definitons, etc. ) and outputs it into a jsonfile using RapidJson.
 When changing names, syntax or adding/removing properties jsonreader needs to be updated as well.
-
+The display_* functions only read alldata -> nothing of it is copied while writing.
 */
 #ifndef DATA_OUT_H
 #define DATA_OUT_H
@@ -10,25 +10,28 @@ When changing names, syntax or adding/removing properties jsonreader needs to be
 #include "data_tree.h"
 
 template <typename Writer>
-void display(Writer& writer, AllData alldata);
+void display(Writer& writer, const AllData& alldata);
+
+template <typename Writer>
+void display_definitions(const AllData& alldata, Writer& writer);
 
 template <typename Writer>
-void display_definitions(AllData alldata, Writer& writer);
+void display_data_tree(const AllData& alldata, Writer& writer);
 
 template <typename Writer>
-void display_data_tree(AllData alldata, Writer& writer);
+void display_meta_data(const AllData& alldata, Writer& writer);
 
 template <typename Writer>
-void display_meta_data(AllData alldata, Writer& writer);
+void display_meta_data_profiler(const AllData& alldata, Writer& writer);
 
 template <typename Writer>
-void display_params(AllData alldata, Writer& writer);
+void display_params(const AllData& alldata, Writer& writer);
 
 template <typename Writer>
-void display_system_node(std::shared_ptr<definitions::SystemTree::SystemNode> node, AllData alldata, Writer& writer);
+void display_system_node(const std::shared_ptr<definitions::SystemTree::SystemNode>& node, const AllData& alldata, Writer& writer);
 
 template <typename Writer>
-void display_system_tree(AllData alldata, Writer& writer);
+void display_system_tree(const AllData& alldata, Writer& writer);
 
 bool DataOut(AllData& alldata);
 
@@ -0,0 +1,58 @@
+/*
+ This is part of the OTF-Profiler. Copyright by ZIH, TU Dresden 2016-2018.
+ Authors: Maximillian Neumann, Denis Hünich, Jens Doleschal
+*/
+
+#ifndef JSON_FILE_H
+#define JSON_FILE_H
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "rapidjson/filewritestream.h"
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/writer.h"
+
+// size of the buffer between the JSON writer and the file
+static const size_t json_buffer_size = 4 * 1024 * 1024;
+
+/*
+Streams a JSON document into fname: document(writer) is called with a rapidjson::Writer (or PrettyWriter if pretty)
+on a FileWriteStream -> memory is bounded by the buffer, the document is never held as text.
+document needs a template operator()(Writer&), e.g.
+    struct { template <typename Writer> void operator()(Writer& w) { ... } }
+*/
+template <typename Document>
+bool WriteJSONFile(const std::string& fname, bool pretty, Document& document) {
+    FILE* file = std::fopen(fname.c_str(), "wb");
+    if (file == nullptr) {
+        std::cerr << "ERROR: could not open '" << fname << "' for writing" << std::endl;
+        return false;
+    }
+
+    std::vector<char>          buffer(json_buffer_size);
+    rapidjson::FileWriteStream stream(file, buffer.data(), buffer.size());
+
+    if (pretty) {
+        rapidjson::PrettyWriter<rapidjson::FileWriteStream> writer(stream);
+        document(writer);
+    } else {
+        rapidjson::Writer<rapidjson::FileWriteStream> writer(stream);
+        document(writer);
+    }
+
+    stream.Put('\n');
+    stream.Flush();
+
+    bool failed = std::ferror(file) != 0;
+    if (std::fclose(file) != 0 || failed) {
+        std::cerr << "ERROR: could not write '" << fname << "'" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+#endif /* JSON_FILE_H */
@@ -9,29 +9,58 @@
 #include <otf2/otf2.h>
 #include "otf2/OTF2_Definitions.h"
 #include "otf2/OTF2_GeneralDefinitions.h"
+#include "metric_intervals.h"
+#include "region_filter.h"
 #include "tracereader.h"
 #include <array>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
 
+/*
+OTF2 string refs -> strings
+    eager: interned in the string table of the definitions
+    lazy:  appended to a raw arena without any lookup, interned when a definition using them is materialized
+*/
 template <typename RefT>
 class StringIdentifier {
    public:
     template <typename... Refs>
-    using Result_t = std::array<std::string*, sizeof...(Refs)>;
+    using Result_t = std::array<definitions::StringRef, sizeof...(Refs)>;
 
    public:
-    StringIdentifier() { string_definitions[OTF2_UNDEFINED_STRING] = ""; }
+    StringIdentifier() = default;
+
+    // starts a new trace, the strings are interned in table
+    void reset(definitions::StringTable* _table, bool _lazy) {
+        table = _table;
+        lazy  = _lazy;
+        raw.assign(1, '\0');
+        string_refs = definitions::DefinitionType<RefT, definitions::StringRef>();
+        string_refs.add(OTF2_UNDEFINED_STRING, definitions::StringRef{});
+    }
 
-    void add(RefT ref, const char* string_def) { string_definitions[ref] = string_def; }
+    void add(RefT ref, const char* string_def) {
+        if (!lazy) {
+            string_refs.add(ref, table->intern(string_def));
+            return;
+        }
+
+        definitions::StringRef string_ref{raw.size()};
+        raw.insert(raw.end(), string_def, string_def + std::strlen(string_def) + 1);
+        string_refs.add(ref, string_ref);
+    }
 
     template <typename... Refs>
-    const std::pair<Result_t<Refs...>, OTF2_CallbackCode> get(Refs... refs) {
+    const std::pair<Result_t<Refs...>, OTF2_CallbackCode> get(Refs... refs) const {
         auto              pos = 0;
         Result_t<Refs...> result{};
 
         for (const auto& ref : {refs...}) {
-            auto it = string_definitions.find(ref);
-            if (it != string_definitions.end())
-                result[pos] = &it->second;
+            auto* string_ref = string_refs.get(ref);
+            if (string_ref != nullptr)
+                result[pos] = *string_ref;
             else
                 return std::make_pair(result, OTF2_CALLBACK_INTERRUPT);
 
@@ -41,8 +70,71 @@ class StringIdentifier {
         return std::make_pair(result, OTF2_CALLBACK_SUCCESS);
     }
 
+    const char* operator[](definitions::StringRef ref) const {
+        return lazy ? raw.data() + ref.offset : (*table)[ref];
+    }
+
+    // ref of a string of this identifier in the string table of the definitions
+    definitions::StringRef intern(definitions::StringRef ref) const {
+        return lazy ? table->intern(raw.data() + ref.offset) : ref;
+    }
+
+    // frees the raw strings -> no materialization afterwards
+    void clear() {
+        std::vector<char>().swap(raw);
+        string_refs = definitions::DefinitionType<RefT, definitions::StringRef>();
+    }
+
+    size_t raw_bytes() const { return raw.size(); }
+
    private:
-    std::map<RefT, std::string> string_definitions;
+    definitions::DefinitionType<RefT, definitions::StringRef> string_refs;
+    definitions::StringTable*                                 table = nullptr;
+    bool                                                      lazy  = false;
+    std::vector<char>                                         raw;
+};
+
+// definition recorded with --lazy-definitions, its strings are refs of the StringIdentifier
+template <typename T>
+struct PendingDefinition {
+    T        definition;
+    uint32_t ordinal;  // order of definition -> the same on every rank
+};
+
+// pending I/O operation -> begin event seen, waiting for the matching complete event
+struct PendingIoEvt {
+    OTF2_TimeStamp begin_time;
+    uint64_t       bytes_request;
+};
+
+class OTF2Reader;
+
+// state of one event reading thread, handed to the event callbacks as userData
+// -> each thread collects into its own call path tree and I/O summary, they are merged after reading
+struct EventReaderState {
+    EventReaderState(OTF2Reader& _reader, AllData& _alldata, data_tree& _call_path_tree,
+                     std::map<uint64_t, IoData>& _io_data)
+        : reader(&_reader),
+          alldata(&_alldata),
+          call_path_tree(&_call_path_tree),
+          io_data(&_io_data),
+          metric_layout(_call_path_tree.metric_layout().get()) {
+        if (metric_layout != nullptr)
+            metric_sample.reset(*metric_layout);
+    }
+
+    OTF2Reader*                 reader;
+    AllData*                    alldata;
+    data_tree*                  call_path_tree;
+    std::map<uint64_t, IoData>* io_data;
+
+    // slots of the synchronous metrics and the values recorded since the last enter/leave
+    const MetricLayout*              metric_layout;
+    MetricSample                     metric_sample;
+    // sampled metrics of the current location
+    MetricIntervals                  metric_intervals;
+    std::deque<StackData>            node_stack;
+    std::map<uint64_t, PendingIoEvt> open_io_events;
 };
 
 class OTF2Reader : public TraceReader {
@@ -58,7 +150,58 @@ class OTF2Reader : public TraceReader {
     bool readStatistics(AllData& alldata);
 
    private:
-    OTF2_Reader* _reader;
+    void buildMetricLayout(AllData& alldata);
+    void buildSampledMetrics(AllData& alldata);
+    void sumSampledMetrics(AllData& alldata);
+    void materializeDefinitions(AllData& alldata);
+
+    // io handle of an event -> with --lazy-definitions the recorded one
+    const definitions::IoHandle* ioHandle(uint64_t handle);
+    // marks a recorded io handle as referenced, only under _iohandle_mutex
+    void hitIoHandle(uint64_t handle);
+
+   private:
+    OTF2_Reader* _reader = nullptr;
+    // trace currently read -> userData of the definition callbacks is the reader itself
+    AllData* _alldata = nullptr;
+
+    StringIdentifier<OTF2_StringRef> _string_id;
+    // file system entry -> its name, a ref of _string_id
+    definitions::DefinitionType<OTF2_IoFileRef, definitions::StringRef> _filesystem_entries;
+
+    // --lazy-definitions: regions and io handles are only recorded, referenced ones are materialized after the events
+    bool                                                                            _lazy_definitions = false;
+    definitions::DefinitionType<uint64_t, PendingDefinition<definitions::Region>>   _pending_regions;
+    definitions::DefinitionType<uint64_t, PendingDefinition<definitions::IoHandle>> _pending_iohandles;
+    std::vector<uint8_t>                                                            _iohandle_hits;
+
+    // CPU and GPU locations to read and their number of events
+    std::vector<uint64_t> _locations;
+    std::vector<uint64_t> _location_events;
+
+    // IoHandle::modes and _iohandle_hits are shared between all event reading threads
+    std::mutex _iohandle_mutex;
+
+    // slots of the synchronous metric classes, built after the definitions
+    std::shared_ptr<MetricLayout> _metric_layout;
+    // members of all other metric classes
+    SampledMetrics _sampled_metrics;
+
+    // --filter-file: resolved once per region at definition time -> one lookup per enter/leave
+    RegionFilter      _region_filter;
+    std::vector<bool> _filtered_regions;
+
+    bool isFiltered(OTF2_RegionRef region) const {
+        return region < _filtered_regions.size() && _filtered_regions[region];
+    }
+
+    // reads local definitions and all events of one location into the given state
+    bool readLocation(EventReaderState& state, OTF2_EvtReaderCallbacks* evt_callbacks, uint64_t location);
+
+    // reads locations with params.num_threads threads until next_location runs dry
+    // -> with more than one thread every thread uses its own state, the results are merged into alldata afterwards
+    bool readLocations(AllData& alldata, OTF2_EvtReaderCallbacks* evt_callbacks,
+                       const std::function<bool(uint64_t&)>& next_location);
 
    private:
     /* ************************************************************** */
@@ -8,6 +8,7 @@
 
 #include <otf.h>
 
+#include "region_filter.h"
 #include "tracereader.h"
 
 class OTFReader : public TraceReader {
@@ -21,6 +22,7 @@ class OTFReader : public TraceReader {
     bool readDefinitions(AllData& alldata);
     bool readEvents(AllData& alldata);
     bool readStatistics(AllData& alldata);
+    bool isReentrant() const { return false; }
 
    private:
     OTF_FileManager* _manager = nullptr;
@@ -0,0 +1,109 @@
+/*
+ This is part of the OTF-Profiler. Copyright by ZIH, TU Dresden 2016-2018.
+ Authors: Maximillian Neumann, Denis Hünich, Jens Doleschal
+*/
+
+#ifndef METRIC_INTERVALS_H
+#define METRIC_INTERVALS_H
+
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include "main_structs.h"
+
+class tree_node;
+
+// members of the metric classes that are not strict synchronous -> their samples are attributed over time
+class SampledMetrics {
+   public:
+    struct Member {
+        uint8_t        position;  // position of the value in the metric event
+        uint64_t       metric_id;
+        MetricMode     mode;
+        MetricDataType result_type;  // ABSOLUTE_* values are integrated over time -> DOUBLE
+        uint32_t       index;        // dense index of the member over all classes
+    };
+
+    // <position in the event, metric id, mode, type of the metric>
+    void add_member(uint64_t class_id, uint8_t position, uint64_t metric_id, MetricMode mode, MetricDataType type);
+
+    const std::vector<Member>* metric_class(uint64_t class_id) const {
+        return class_id < classes.size() && !classes[class_id].empty() ? &classes[class_id] : nullptr;
+    }
+
+    bool contains(uint64_t metric_id) const { return metric_ids.count(metric_id) != 0; }
+
+    size_t num_members() const { return num; }
+    bool   empty() const { return num == 0; }
+
+   private:
+    // indexed by the (dense) metric class id
+    std::vector<std::vector<Member>> classes;
+    std::unordered_set<uint64_t>     metric_ids;
+    size_t                           num = 0;
+};
+
+/*
+Attribution of sampled metrics for one location.
+Every enter/leave starts a segment: <start time, node on top of the call stack>. The segments are kept in a ring
+buffer until every member was sampled behind them. A sample covers an interval depending on its mode:
+    ACCUMULATED_START/POINT   value - previous value, since the previous sample
+    *_LAST                    value, since the previous sample
+    *_NEXT                    value, until the next sample -> attributed when the next sample arrives
+    ABSOLUTE_POINT            mean of value and previous value * seconds, since the previous sample
+    RELATIVE_POINT            value, to the node active at the sample
+The interval is split over its segments proportional to their time and added to the exclusive (and inclusive)
+value of the segment's node. If the buffer is full, the oldest segment is merged into the next one -> its time is
+attributed to the next node. Memory per location is bounded by the capacity, each event costs O(1) amortized.
+*/
+class MetricIntervals {
+   public:
+    explicit MetricIntervals(size_t _capacity = 4096) : capacity(_capacity) {}
+
+    // start of a location, without sampled metrics nothing is recorded
+    void reset(const SampledMetrics* _metrics, uint64_t location_id, uint64_t _timer_resolution);
+
+    bool                  active() const { return metrics != nullptr; }
+    const SampledMetrics* sampled() const { return metrics; }
+
+    // the node on top of the call stack changed (nullptr -> outside of any region)
+    void set_node(uint64_t time, tree_node* node);
+
+    void sample(const SampledMetrics::Member& member, uint64_t time, MetricDataType type, MetricData::Data value);
+
+   private:
+    struct Segment {
+        uint64_t   start;
+        tree_node* node;
+    };
+
+    struct MemberState {
+        bool             has_prev = false;
+        bool             has_next = false;
+        uint64_t         prev_time;
+        uint64_t         seq;  // segment active at prev_time
+        double           prev_value;
+        MetricData::Data prev_raw;
+        double           next_value;
+    };
+
+    Segment&       at(uint64_t seq) { return segments[seq % capacity]; }
+    const Segment& at(uint64_t seq) const { return segments[seq % capacity]; }
+
+    void trim();
+    void attribute(const SampledMetrics::Member& member, const MemberState& state, uint64_t from, uint64_t to,
+                   double amount);
+    void add(tree_node* node, const SampledMetrics::Member& member, double amount);
+
+    const SampledMetrics*    metrics = nullptr;
+    uint64_t                 location;
+    uint64_t                 timer_resolution;
+    size_t                   capacity;
+    std::vector<Segment>     segments;
+    uint64_t                 first_seq = 0;
+    uint64_t                 next_seq  = 0;
+    std::vector<MemberState> states;
+};
+
+#endif /* METRIC_INTERVALS_H */
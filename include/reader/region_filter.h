@@ -0,0 +1,52 @@
+/*
+ This is part of the OTF-Profiler. Copyright by ZIH, TU Dresden 2016-2018.
+ Authors: Maximillian Neumann, Denis Hünich, Jens Doleschal
+*/
+
+#ifndef REGION_FILTER_H
+#define REGION_FILTER_H
+
+#include <string>
+#include <vector>
+
+/*
+Region filter in the syntax of Score-P filter files (--filter-file):
+
+    SCOREP_REGION_NAMES_BEGIN
+        EXCLUDE *
+        INCLUDE main
+                foo*
+        EXCLUDE MANGLED _Z3barv
+    SCOREP_REGION_NAMES_END
+    SCOREP_FILE_NAMES_BEGIN
+        EXCLUDE *external*
+    SCOREP_FILE_NAMES_END
+
+Patterns are shell wildcards, '#' starts a comment. Inside a block the last matching rule wins, everything is
+included by default. A region is excluded if its name or its source file is excluded.
+*/
+class RegionFilter {
+   public:
+    RegionFilter() = default;
+
+    // reads the rules of a filter file, prints an error and returns false if that fails
+    bool load(const std::string& file_name);
+
+    bool empty() const { return region_rules.empty() && file_rules.empty(); }
+
+    bool excludes(const std::string& name, const std::string& mangled_name, const std::string& file) const;
+
+   private:
+    struct Rule {
+        bool        exclude;
+        bool        mangled;
+        std::string pattern;
+    };
+
+    static bool excluded_by(const std::vector<Rule>& rules, const std::string& name, const std::string& mangled_name);
+
+    std::vector<Rule> region_rules;
+    std::vector<Rule> file_rules;
+};
+
+#endif /* REGION_FILTER_H */
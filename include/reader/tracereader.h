@@ -17,16 +17,34 @@ class TraceReader {
     virtual bool readDefinitions(AllData& alldata) = 0;
     virtual bool readEvents(AllData& alldata)      = 0;
     virtual bool readStatistics(AllData& alldata)  = 0;
+
+    // false if the reader keeps its state in file-static variables -> only one instance may read at a time
+    virtual bool isReentrant() const { return true; }
 };
 
 std::unique_ptr<TraceReader> getTraceReader(AllData& alldata);
 
+// --locations: a location is read if its id, its name or the name of one of its system tree ancestors is selected
+inline bool location_selected(const LocationFilter& filter, uint64_t location, const std::string& name,
+                              const definitions::SystemTree::SystemNode_t* parent) {
+    if (filter.empty() || filter.selects_id(location) || filter.selects_name(name))
+        return true;
+
+    for (; parent != nullptr; parent = parent->parent)
+        if (filter.selects_name(parent->data.name))
+            return true;
+
+    return false;
+}
+
 // data stack for function data -> enter/leave callbacks etc.
 struct StackData {
     tree_node* node_p;
 
     uint64_t time;
     uint64_t child_incl;
+    // --max-depth: number of open frames folded into this one
+    uint64_t folded;
 };
 
 #endif /* TRACEREADER_H */
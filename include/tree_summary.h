@@ -0,0 +1,130 @@
+/*
+ This is part of the OTF-Profiler. Copyright by ZIH, TU Dresden 2016-2018.
+ Authors: Maximillian Neumann, Denis Hünich, Jens Doleschal
+*/
+
+#ifndef TREE_SUMMARY_H
+#define TREE_SUMMARY_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "definitions.h"
+
+class data_tree;
+class tree_node;
+
+/*
+Statistics of every call path over its locations: number of locations with data and per value sum, min, max and sum
+of squares. Function, message and collop values and UINT64 metrics are kept as uint64_t, the other metrics as double.
+The values are dense arrays indexed by path (tree_node::index or global path id) -> the summaries of several ranks are
+combined element-wise, e.g. with MPI_Reduce. Enough for the summary outputs (JSON, DOT), no per-location data.
+*/
+class TreeSummary {
+   public:
+    enum Field : uint32_t {
+        COUNT,
+        INCL_TIME,
+        EXCL_TIME,
+        MSG_COUNT_SEND,
+        MSG_COUNT_RECV,
+        MSG_BYTES_SEND,
+        MSG_BYTES_RECV,
+        COLLOP_COUNT_SEND,
+        COLLOP_COUNT_RECV,
+        COLLOP_BYTES_SEND,
+        COLLOP_BYTES_RECV,
+        NUM_FIELDS
+    };
+
+    // how the arrays of two summaries are combined
+    enum class Combine { SUM, MIN, MAX };
+
+    template <typename T>
+    struct Stat {
+        T      sum;
+        T      min;
+        T      max;
+        double sumsq;
+
+        // at least one location has a value
+        bool present() const { return min <= max; }
+    };
+
+    // values of a metric: inclusive at field incl, exclusive at incl + 1 of the uint64_t or double values
+    struct MetricFields {
+        uint64_t metric_id;
+        bool     integer;
+        uint32_t incl;
+    };
+
+    TreeSummary() = default;
+    // metrics of the definitions -> the same layout on every rank
+    TreeSummary(const definitions::Definitions& definitions, size_t num_paths);
+
+    // statistics of all nodes of a tree, path = tree_node::index
+    static TreeSummary of_tree(data_tree& tree, const definitions::Definitions& definitions);
+
+    // num_paths paths without data
+    void reset(size_t num_paths);
+    // adds the locations of node to path
+    void add(size_t path, const tree_node& node);
+    // copy with path p at position[p]
+    TreeSummary reordered(const std::vector<size_t>& position, size_t num_paths) const;
+
+    size_t num_paths() const { return locations_.size(); }
+    size_t path_bytes() const;
+
+    uint64_t locations(size_t path) const { return locations_[path]; }
+
+    Stat<uint64_t> field(size_t path, Field f) const { return integer(path, f); }
+
+    const std::vector<MetricFields>& metrics() const { return metric_fields; }
+
+    Stat<uint64_t> integer(size_t path, uint32_t f) const {
+        auto i = path * int_width + f;
+        return {int_sum[i], int_min[i], int_max[i], int_sumsq[i]};
+    }
+
+    Stat<double> floating(size_t path, uint32_t f) const {
+        auto i = path * double_width + f;
+        return {double_sum[i], double_min[i], double_max[i], double_sumsq[i]};
+    }
+
+    // calls fn(std::vector<T>& values, size_t values_per_path, Combine combine) for every array
+    template <typename Fn>
+    void arrays(Fn& fn) {
+        fn(locations_, 1, Combine::SUM);
+        fn(int_sum, int_width, Combine::SUM);
+        fn(int_min, int_width, Combine::MIN);
+        fn(int_max, int_width, Combine::MAX);
+        fn(int_sumsq, int_width, Combine::SUM);
+        fn(double_sum, double_width, Combine::SUM);
+        fn(double_min, double_width, Combine::MIN);
+        fn(double_max, double_width, Combine::MAX);
+        fn(double_sumsq, double_width, Combine::SUM);
+    }
+
+   private:
+    void add_int(size_t i, uint64_t value);
+    void add_double(size_t i, double value);
+
+    std::vector<MetricFields>              metric_fields;
+    std::unordered_map<uint64_t, uint32_t> metric_index;  // metric id -> position in metric_fields
+
+    size_t int_width    = NUM_FIELDS;
+    size_t double_width = 0;
+
+    std::vector<uint64_t> locations_;
+    std::vector<uint64_t> int_sum;
+    std::vector<uint64_t> int_min;
+    std::vector<uint64_t> int_max;
+    std::vector<double>   int_sumsq;
+    std::vector<double>   double_sum;
+    std::vector<double>   double_min;
+    std::vector<double>   double_max;
+    std::vector<double>   double_sumsq;
+};
+
+#endif /* TREE_SUMMARY_H */
@@ -6,9 +6,12 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <cctype>
 #include <chrono>
 #include <iostream>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "otf-profiler-config.h"
 
@@ -91,12 +94,104 @@ class TimeMeasurement {
     std::map<ScopeID, Scope> scopes;
 };
 
+/*
+Selection of the locations that are read at all (--locations).
+The list is comma separated, every entry is one of
+    <id>            a single location id
+    <first>-<last>  a range of location ids (inclusive)
+    @<name>         all locations below the system tree node (or location group) with this name
+An empty filter selects every location.
+*/
+struct LocationFilter {
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    std::vector<std::string>                   names;
+
+    bool empty() const { return ranges.empty() && names.empty(); }
+
+    bool selects_id(uint64_t location) const {
+        for (const auto& range : ranges)
+            if (range.first <= location && location <= range.second)
+                return true;
+
+        return false;
+    }
+
+    bool selects_name(const std::string& name) const {
+        for (const auto& n : names)
+            if (n == name)
+                return true;
+
+        return false;
+    }
+
+    bool parse(const std::string& list) {
+        size_t begin = 0;
+        while (begin <= list.size()) {
+            auto end = list.find(',', begin);
+            if (end == std::string::npos)
+                end = list.size();
+
+            auto entry = list.substr(begin, end - begin);
+            begin      = end + 1;
+
+            if (entry.empty())
+                continue;
+
+            if (entry[0] == '@') {
+                if (entry.size() == 1)
+                    return invalid(entry);
+
+                names.push_back(entry.substr(1));
+                continue;
+            }
+
+            // stoull accepts a leading sign
+            if (!std::isdigit(entry[0]))
+                return invalid(entry);
+
+            try {
+                size_t   pos;
+                uint64_t first = std::stoull(entry, &pos);
+                uint64_t last  = first;
+
+                if (pos < entry.size()) {
+                    if (entry[pos] != '-' || pos + 1 >= entry.size() || !std::isdigit(entry[pos + 1]))
+                        return invalid(entry);
+
+                    size_t last_pos;
+                    last = std::stoull(entry.substr(pos + 1), &last_pos);
+                    if (pos + 1 + last_pos != entry.size() || last < first)
+                        return invalid(entry);
+                }
+
+                ranges.push_back({first, last});
+            } catch (const std::logic_error&) {
+                return invalid(entry);
+            }
+        }
+
+        return !empty();
+    }
+
+   private:
+    bool invalid(const std::string& entry) {
+        std::cerr << "ERROR: Invalid location selection '" << entry << "'" << std::endl;
+        return false;
+    }
+};
+
+// system tree level whose nodes are the threads of the cube output, the locations below are aggregated
+enum class CubeLevel : uint8_t { LOCATION, PROCESS, NODE, MACHINE };
+
 struct Params {
     uint32_t max_file_handles = 50;           // TODO sinn/unsinn?
     uint32_t buffer_size      = 1024 * 1024;  // TODO sinn/unsinn?
     // uint32_t    max_groups         = 16;
     // bool        logaxis            = true;
-    uint8_t verbose_level = 0;
+    uint8_t  verbose_level    = 0;
+    uint32_t num_threads      = 1;
+    uint32_t batch_jobs       = 1;
+    uint32_t max_depth        = 0;  // 0 -> unlimited
     // bool        read_from_stats    = false;
     double       node_min_ratio     = 0;
     int32_t     rank               = -1;
@@ -107,10 +202,17 @@ struct Params {
     bool        create_json        = false;
     bool        create_dot         = false;
     bool        data_dump           = false;
+    bool        pretty_json        = false;
+    bool        lazy_definitions   = false;
+    bool        global_paths       = false;
+    CubeLevel   cube_level         = CubeLevel::LOCATION;
     bool        summarize_it       = false;  // TODO added for testing
     std::string input_file_name    = "";
     std::string input_file_prefix  = "";
     std::string output_file_prefix = "result";
+    std::string batch_file         = "";
+    std::string filter_file        = "";
+    LocationFilter locations;
 
     bool parseCommandLine(int argc, char** argv) {
         // TODO help text and check for no arguments
@@ -124,24 +226,47 @@ struct Params {
                           << "formats." << std::endl
                           << std::endl
                           << " Syntax: " << argv[0] << " -i <input file name> [options]" << std::endl
+                          << "         " << argv[0] << " --batch <list file> [options]" << std::endl
                           << std::endl
                           << "   options:" << std::endl
                           << "      -h, --help          show this help message" << std::endl
                           << std::endl
                           << "      --cube              generates CUBE xml profile" << std::endl
+                          << "        --cube-level <level>  location, process, node or machine: aggregate the" << std::endl
+                          << "                          locations below each system tree node of that level" << std::endl
+                          << "                          (default: location)" << std::endl
                           << "      --json              generates json ouptut file" << std::endl
                           << "      --dot               generates dot file for drawing graphs" << std::endl
                           << "        -fi, --filter <percent>    only show path, where a node took at least num \% of total time" << std::endl
                           << "        -t, --top <n>     only show top num nodes" << std::endl
                           << "        -r, --rank <n>    only show specific rank" << std::endl
                           << "      --datadump          dump all data into json file" << std::endl
+                          << "      --pretty            indent the json and datadump output" << std::endl
                           << std::endl
                           << "      -b <size>           set buffersize of the reader in Byte" << std::endl
                           << "                          (default: 1 M)" << std::endl
                           << "      -f <n>              max. number of filehandles available per rank" << std::endl
                           << "                          (default: 50)" << std::endl
                           << "      -i <file>           specify the input tracefile name or json dump file" << std::endl
+                          << "      --batch <file>      profile every trace listed in file, one per line:" << std::endl
+                          << "                          <input file> [<output prefix>]" << std::endl
+                          << "                          (default prefix: <-o prefix>_<number of the trace>)" << std::endl
+                          << "      --batch-jobs <n>    number of traces profiled at the same time" << std::endl
+                          << "                          (default: 1, always 1 with MPI)" << std::endl
+                          << "      --locations <list>  only read the selected locations, comma separated list of" << std::endl
+                          << "                          <id>, <first>-<last> and @<system tree node name>" << std::endl
+                          << "      --filter-file <file> skip regions excluded by a Score-P filter file, their time" << std::endl
+                          << "                          is attributed to the calling region" << std::endl
+                          << "      --lazy-definitions  keep only the regions and I/O handles referenced by events," << std::endl
+                          << "                          groups only with --datadump (OTF2)" << std::endl
+                          << "      --global-paths      reduce with global call path ids, rows of all ranks are" << std::endl
+                          << "                          gathered at rank 0 (otf-profiler-mpi, with --cube or" << std::endl
+                          << "                          --datadump)" << std::endl
+                          << "      --max-depth <n>     fold calls deeper than n into their ancestor at depth n" << std::endl
+                          << "                          (default: 0, unlimited)" << std::endl
                           << "      -nm, --no-metrics   neglect metric events" << std::endl
+                          << "      --threads <n>       number of threads reading the locations of a trace and" << std::endl
+                          << "                          filling the cube output (default: 1)" << std::endl
                           << "      -o <prefix>         specify the prefix of output file(s)" << std::endl
                           << "                          (default: result)" << std::endl
                           << "      -v <level>          set verbosity level" << std::endl
@@ -164,6 +289,23 @@ struct Params {
             } else if (arguments[i] == "--cube") {
                 create_cube     = true;
                 output_type_set = true;
+            } else if (arguments[i] == "--cube-level") {
+                if (!checkNext(arguments, i))
+                    return false;
+
+                const auto& level = arguments[++i];
+                if (level == "location")
+                    cube_level = CubeLevel::LOCATION;
+                else if (level == "process")
+                    cube_level = CubeLevel::PROCESS;
+                else if (level == "node")
+                    cube_level = CubeLevel::NODE;
+                else if (level == "machine")
+                    cube_level = CubeLevel::MACHINE;
+                else {
+                    std::cerr << "ERROR: Invalid argument for option '" << arguments[i - 1] << "'" << std::endl;
+                    return false;
+                }
             } else if (arguments[i] == "--json") {
                 create_json = true;
                 output_type_set = true;
@@ -194,6 +336,8 @@ struct Params {
             top_nodes = value;
             ++i;
             create_dot = true;
+            } else if (arguments[i] == "--pretty") {
+                pretty_json = true;
             } else if (arguments[i] == "--datadump") {
                 data_dump = true;
                 output_type_set = true;
@@ -226,10 +370,51 @@ struct Params {
                 // verursachen (nicht strikt synchrone)
             } else if (arguments[i] == "-nm" || arguments[i] == "--no-metrics") {
                 read_metrics = false;
+            } else if (arguments[i] == "--threads") {
+                auto value = checkNextValue(arguments, i);
+                if (value < 1)
+                    return false;
+
+                num_threads = value;
+                ++i;
+            } else if (arguments[i] == "--locations") {
+                if (!checkNext(arguments, i))
+                    return false;
+
+                if (!locations.parse(arguments[++i]))
+                    return false;
+            } else if (arguments[i] == "--filter-file") {
+                if (!checkNext(arguments, i))
+                    return false;
+
+                filter_file = arguments[++i];
+            } else if (arguments[i] == "--lazy-definitions") {
+                lazy_definitions = true;
+            } else if (arguments[i] == "--global-paths") {
+                global_paths = true;
+            } else if (arguments[i] == "--max-depth") {
+                auto value = checkNextValue(arguments, i);
+                if (value < 0)
+                    return false;
+
+                max_depth = value;
+                ++i;
+            } else if (arguments[i] == "--batch") {
+                if (!checkNext(arguments, i))
+                    return false;
+
+                batch_file = arguments[++i];
+            } else if (arguments[i] == "--batch-jobs") {
+                auto value = checkNextValue(arguments, i);
+                if (value < 1)
+                    return false;
+
+                batch_jobs = value;
+                ++i;
             }
         }
 
-        if (input_file_name == "") {
+        if (input_file_name == "" && batch_file == "") {
             std::cerr << "ERROR: No input tracefile name given. See --help | -h for further information." << std::endl;
             return false;
         }
@@ -5,71 +5,117 @@
 
 #include "data_tree.h"
 
+#include <algorithm>
+#include <new>
 #include <stack>
+#include <utility>
 
 using namespace std;
 
-data_tree::data_tree() {}
+const size_t   node_arena::first_block;
+const size_t   node_arena::max_block;
+const size_t   data_tree::npos;
+const uint64_t tree_payload::no_parent;
 
-// generating a tree out of a mapping sent with MPI - ReduceData - (has no data inside a tree node)
-data_tree::data_tree(map<uint64_t, tuple<uint64_t, uint64_t, shared_ptr<tree_node>>>& mapping) {
-    shared_ptr<tree_node> tmp_node;
+node_arena::block::block(size_t _capacity)
+    : storage(static_cast<tree_node*>(::operator new(_capacity * sizeof(tree_node)))), capacity(_capacity) {}
 
-    for (auto it = mapping.begin(); it != mapping.end(); it++) {
-        if (get<1>(it->second) != (uint64_t)-1) {
-            tmp_node = insert_node(get<0>(it->second), get<2>(mapping.find(get<1>(it->second))->second));
+node_arena::block::~block() {
+    for (size_t i = 0; i < used; ++i)
+        storage[i].~tree_node();
 
-        } else {
-            tmp_node = insert_node(get<0>(it->second), (shared_ptr<tree_node>)nullptr);
-        }
+    ::operator delete(storage);
+}
 
-        get<2>(it->second) = tmp_node;
+tree_node* node_arena::create(uint64_t function_id, tree_node* parent) {
+    if (blocks.empty() || blocks.back()->used == blocks.back()->capacity) {
+        auto capacity = blocks.empty() ? first_block : min(blocks.back()->capacity * 2, max_block);
+        blocks.push_back(make_shared<block>(capacity));
     }
+
+    auto& last = *blocks.back();
+    auto* node = new (last.storage + last.used) tree_node(function_id, parent);
+    ++last.used;
+
+    return node;
 }
 
-// add a node without data
-shared_ptr<tree_node> data_tree::insert_node(uint64_t function_id, shared_ptr<tree_node> parent) {
-    if (parent == nullptr) {
-        shared_ptr<tree_node> tmp = std::make_shared<tree_node>(function_id, parent);
+void node_arena::splice(node_arena& rhs) {
+    if (blocks.empty()) {
+        blocks.swap(rhs.blocks);
+        return;
+    }
 
-        root_nodes.insert(make_pair(function_id, tmp));
+    // keep the block with free space at the end -> new nodes still go there
+    auto current = blocks.back();
+    blocks.pop_back();
+    blocks.insert(blocks.end(), rhs.blocks.begin(), rhs.blocks.end());
+    blocks.push_back(current);
 
-        return tmp;
+    rhs.blocks.clear();
+}
 
-    } else {
-        auto node = parent->children.find(function_id);
+size_t node_arena::num_nodes() const {
+    size_t count = 0;
+    for (const auto& b : blocks)
+        count += b->used;
 
-        if (node == parent->children.end()) {
-            shared_ptr<tree_node> tmp = std::make_shared<tree_node>(function_id, parent);
+    return count;
+}
 
-            parent->children.insert(node, make_pair(function_id, tmp));
+size_t node_arena::allocated_bytes() const {
+    size_t bytes = 0;
+    for (const auto& b : blocks)
+        bytes += b->capacity * sizeof(tree_node);
 
-            return tmp;
+    return bytes;
+}
 
-        } else {
-            return nullptr;
-        }
-    }
+data_tree::data_tree() {}
+
+void data_tree::set_locations(const vector<uint64_t>& location_ids) {
+    location_index = make_shared<LocationIndex>(location_ids);
+}
+
+size_t data_tree::node_data_bytes() {
+    size_t bytes = 0;
+    for (auto it = begin(); it != end(); ++it)
+        bytes += it->node_data.allocated_bytes();
+
+    return bytes;
 }
 
-// same as above with different intake and return
+// add a node without data
 tree_node* data_tree::insert_node(uint64_t function_id, tree_node* parent) {
     if (parent == nullptr) {
-        shared_ptr<tree_node> tmp = std::make_shared<tree_node>(function_id, parent);
+        auto node = root_nodes.find(function_id);
+
+        if (node != root_nodes.end())
+            return nullptr;
+
+        thaw();
 
-        root_nodes.insert(make_pair(function_id, tmp));
+        tree_node* tmp = nodes.create(function_id, parent);
+        tmp->node_data.set_index(location_index.get());
+        tmp->node_data.set_layout(metric_layout_.get());
 
-        return tmp.get();
+        root_nodes.insert(node, make_pair(function_id, tmp));
+
+        return tmp;
 
     } else {
         auto node = parent->children.find(function_id);
 
         if (node == parent->children.end()) {
-            shared_ptr<tree_node> tmp = std::make_shared<tree_node>(function_id, parent);
+            thaw();
 
-            parent->children.insert(make_pair(function_id, tmp));
+            tree_node* tmp = nodes.create(function_id, parent);
+            tmp->node_data.set_index(location_index.get());
+            tmp->node_data.set_layout(metric_layout_.get());
 
-            return tmp.get();
+            parent->children.insert(node, make_pair(function_id, tmp));
+
+            return tmp;
 
         } else {
             return nullptr;
@@ -77,21 +123,11 @@ tree_node* data_tree::insert_node(uint64_t function_id, tree_node* parent) {
     }
 }
 
-// copy a node into the tree - with it's data
-void data_tree::insert_node(shared_ptr<tree_node> aNode) {
-    if (aNode->parent == NULL) {
-        root_nodes.insert(make_pair(aNode->function_id, aNode));
-    } else {
-        auto node = aNode->parent->children.find(aNode->function_id);
-
-        if (node == aNode->parent->children.end()) {
-            aNode->parent->children.insert(make_pair(aNode->function_id, aNode));
-        }
-    }
-}
-
 // merge a (temporary) tree into "main" tree
 void data_tree::merge_tree(data_tree& rhs_tree) {
+    thaw();
+    rhs_tree.thaw();
+
     for (auto it : rhs_tree.root_nodes) {
         auto lhs_node = root_nodes.find(it.first);
 
@@ -102,17 +138,28 @@ void data_tree::merge_tree(data_tree& rhs_tree) {
             merge_node(lhs_node->second, it.second);
         }
     }
+
+    // sub trees of rhs are linked into this tree now -> this tree owns them
+    // (merged nodes of rhs stay allocated until the tree is freed, but their data and children were released)
+    nodes.splice(rhs_tree.nodes);
+    rhs_tree.root_nodes.clear();
+
+    if (rhs_tree.location_index != nullptr && rhs_tree.location_index != location_index)
+        merged_indices.push_back(rhs_tree.location_index);
+    merged_indices.insert(merged_indices.end(), rhs_tree.merged_indices.begin(), rhs_tree.merged_indices.end());
+
+    if (rhs_tree.metric_layout_ != nullptr && rhs_tree.metric_layout_ != metric_layout_)
+        merged_layouts.push_back(rhs_tree.metric_layout_);
+    merged_layouts.insert(merged_layouts.end(), rhs_tree.merged_layouts.begin(), rhs_tree.merged_layouts.end());
 }
 
-// merge two nodes -- copying rhs_node's content into lhs's
+// merge two nodes -- moving rhs_node's content into lhs's
 // should only be used if one knows that the data inside a node is unique (location wise)
-void data_tree::merge_node(shared_ptr<tree_node>& lhs_node, shared_ptr<tree_node>& rhs_node) {
-    for (auto it : rhs_node->node_data) {
-        lhs_node->node_data.insert(it);
-    }
+void data_tree::merge_node(tree_node* lhs_node, tree_node* rhs_node) {
+    lhs_node->node_data.merge(move(rhs_node->node_data));
 
-    lhs_node->have_collop.insert(rhs_node->have_collop.begin(), rhs_node->have_collop.end());
-    lhs_node->have_message.insert(rhs_node->have_message.begin(), rhs_node->have_message.end());
+    lhs_node->has_p2p    = lhs_node->has_p2p || rhs_node->has_p2p;
+    lhs_node->has_collop = lhs_node->has_collop || rhs_node->has_collop;
 
     // test for children == children
     for (auto it : rhs_node->children) {
@@ -124,82 +171,130 @@ void data_tree::merge_node(shared_ptr<tree_node>& lhs_node, shared_ptr<tree_node
             insert_sub_tree(lhs_node, it.second);
         }
     }
+
+    rhs_node->children.clear();
 }
 
 // TODO zu geringe funktionalität? -> benötigen wir es gesondert?
-void data_tree::insert_sub_tree(shared_ptr<tree_node>& parent, shared_ptr<tree_node>& n_node) {
-    n_node->parent = parent.get();  // shared_ptr<tree_node>(parent);
+void data_tree::insert_sub_tree(tree_node* parent, tree_node* n_node) {
+    thaw();
+
+    n_node->parent = parent;
 
     parent->children.insert(make_pair(n_node->function_id, n_node));
 }
 
-/*
-    TODO ist aufgebläht -> wird schlimmer um so mehr daten kommen -> andere implementation möglich?
-    ohne die kombinierte funktionalität zu zerfasern
-    -> evtl neuimplementation mit iterrator
-*/
-// iterate through the tree, generate a mapping and fill the given data deques
-// for communication via MPI
-// only getting called by serialize_data - not intended for usage on it's own
-void getting_serial(map<uint64_t, pair<uint64_t, uint64_t>>&                 mapping,
-                    deque<tuple<uint64_t, uint64_t, FunctionData*>>&         f_data,
-                    deque<tuple<uint64_t, uint64_t, MessageData*>>&          m_data,
-                    deque<tuple<uint64_t, uint64_t, CollopData*>>&           c_data,
-                    deque<tuple<uint64_t, uint64_t, uint64_t, MetricData*>>& met_data, shared_ptr<tree_node>& aNode,
-                    uint64_t& counter, stack<uint64_t>& node_stack) {
-    if (!node_stack.empty()) {
-        // insert as common node
-        mapping.insert(make_pair(counter, make_pair(aNode->function_id, node_stack.top())));
-        node_stack.push(counter);
+// function to serialize data for the MPI communication -> node ids are the positions in the pre-order index
+bool data_tree::serialize_data(tree_payload& payload, tree_payload::cursor& position, size_t max_bytes) {
+    payload.clear();
+    freeze();
 
-    } else {
-        // insert as root node
-        mapping.insert(make_pair(counter, make_pair(aNode->function_id, (uint64_t)-1)));
-        node_stack.push(counter);
-    }
+    auto full = [&payload, max_bytes]() { return payload.bytes() > 0 && payload.bytes() >= max_bytes; };
 
-    // add all the data \o/
-    for (auto it = aNode->node_data.begin(); it != aNode->node_data.end(); ++it) {
-        f_data.push_back(make_tuple(counter, it->first, &it->second.f_data));
+    for (; position.node < order.size(); ++position.node, position.row = 0, position.node_sent = false) {
+        auto* node = order[position.node].node;
+        auto  id   = static_cast<uint64_t>(position.node);
 
-        if (aNode->has_p2p) {
-            m_data.push_back(make_tuple(counter, it->first, &it->second.m_data));
-        }
+        if (!position.node_sent) {
+            if (full())
+                return true;
+
+            auto parent = order[position.node].parent != npos ? order[position.node].parent : tree_payload::no_parent;
 
-        if (aNode->has_collop) {
-            c_data.push_back(make_tuple(counter, it->first, &it->second.c_data));
+            payload.nodes.push_back({node->function_id, parent});
+            position.node_sent = true;
         }
 
-        for (auto it_metric = it->second.metrics.begin(); it_metric != it->second.metrics.end(); ++it_metric)
-            met_data.push_back(make_tuple(counter, it->first, it_metric->first, &it_metric->second));
+        auto& table = node->node_data;
+        for (const auto& data : table) {
+            // rows of the node sent with the previous chunk
+            if (data.row < position.row)
+                continue;
+
+            if (full()) {
+                position.row = data.row;
+                return true;
+            }
+
+            payload.functions.push_back({id, data.first, table.f_data(data.row)});
+
+            if (node->has_p2p)
+                payload.messages.push_back({id, data.first, table.m_data(data.row)});
+
+            if (node->has_collop)
+                payload.collops.push_back({id, data.first, table.c_data(data.row)});
+
+            for (const auto& metric : data.second.metrics)
+                payload.metrics.push_back({id, data.first, metric.first, static_cast<uint64_t>(metric.second.type),
+                                           metric.second.data_incl, metric.second.data_excl});
+        }
     }
-    // counter works as an improvised node id
-    counter++;
 
-    // recursive call
-    for (auto it = aNode->children.begin(); it != aNode->children.end(); it++) {
-        getting_serial(mapping, f_data, m_data, c_data, met_data, it->second, counter, node_stack);
+    return false;
+}
+
+// generating the tree out of the chunks sent with MPI - ReduceData
+void data_tree::deserialize_data(const tree_payload& payload, vector<tree_node*>& nodes) {
+    for (const auto& node : payload.nodes) {
+        assert(node.parent == tree_payload::no_parent || node.parent < nodes.size());
+
+        auto* parent = node.parent != tree_payload::no_parent ? nodes[node.parent] : nullptr;
+        auto* added  = insert_node(node.function_id, parent);
+
+        // path exists already -> received into a complete tree (global path ids)
+        if (added == nullptr)
+            added = parent != nullptr ? parent->children[node.function_id] : root_nodes[node.function_id];
+
+        nodes.push_back(added);
     }
 
-    node_stack.pop();
+    /*
+     * insert is without checks for existence because an analysis rank is working on its trace locations
+     * exclusively -> the data of a location comes from exactly one rank
+     */
+    for (const auto& entry : payload.functions)
+        nodes[entry.node]->add_data(entry.location, entry.data);
+
+    for (const auto& entry : payload.messages)
+        nodes[entry.node]->add_data(entry.location, entry.data);
+
+    for (const auto& entry : payload.collops)
+        nodes[entry.node]->add_data(entry.location, entry.data);
+
+    for (const auto& entry : payload.metrics)
+        nodes[entry.node]->add_data(entry.location, entry.metric_id,
+                                    MetricData{static_cast<MetricDataType>(entry.type), entry.incl, entry.excl});
 }
 
-// function to serialize data for the MPI communication
-void data_tree::serialize_data(map<uint64_t, pair<uint64_t, uint64_t>>&                 mapping,
-                               deque<tuple<uint64_t, uint64_t, FunctionData*>>&         f_data,
-                               deque<tuple<uint64_t, uint64_t, MessageData*>>&          m_data,
-                               deque<tuple<uint64_t, uint64_t, CollopData*>>&           c_data,
-                               deque<tuple<uint64_t, uint64_t, uint64_t, MetricData*>>& met_data) {
-    stack<uint64_t> node_stack;
-    uint64_t        counter = 0;  //<- gibt die node_id an die sonst nicht existiert, sie ist für das
-                                  // mapping allerdings wichtig -> reduce-Schritt
-
-    auto it   = root_nodes.begin();
-    auto it_e = root_nodes.end();
-
-    for (; it != it_e; it++) {
-        getting_serial(mapping, f_data, m_data, c_data, met_data, it->second, counter, node_stack);
+void data_tree::freeze() {
+    if (is_frozen)
+        return;
+
+    order.clear();
+
+    // pre-order via an explicit stack, children are pushed in reverse to keep the order of the maps
+    stack<pair<tree_node*, size_t>> pending;
+    for (auto it = root_nodes.rbegin(); it != root_nodes.rend(); ++it)
+        pending.push(make_pair(it->second, npos));
+
+    while (!pending.empty()) {
+        auto* node   = pending.top().first;
+        auto  parent = pending.top().second;
+        pending.pop();
+
+        node->index = order.size();
+        order.push_back({node, parent, 1, parent == npos ? 0 : order[parent].depth + 1});
+
+        for (auto it = node->children.rbegin(); it != node->children.rend(); ++it)
+            pending.push(make_pair(it->second, node->index));
     }
+
+    // children come after their parent -> sum up the subtree sizes backwards
+    for (size_t i = order.size(); i-- > 0;)
+        if (order[i].parent != npos)
+            order[order[i].parent].subtree_size += order[i].subtree_size;
+
+    is_frozen = true;
 }
 
 tree_iter data_tree::begin() {
@@ -217,117 +312,42 @@ tree_iter data_tree::end() {
 }
 
 tree_node::tree_node(const uint64_t _function_id, tree_node* _parent)
-    : function_id(_function_id),
-      parent(_parent),
-      last_loc((uint64_t)-1),
-      last_data(nullptr),
-      has_p2p(false),
-      has_collop(false) {}
-
-tree_node::tree_node(const uint64_t _function_id, const shared_ptr<tree_node>& _parent)
-    : function_id(_function_id),
-      parent(_parent.get()),
-      last_loc((uint64_t)-1),
-      last_data(nullptr),
-      has_p2p(false),
-      has_collop(false) {}
-
-tree_node::tree_node(const uint64_t _function_id, const shared_ptr<tree_node>& _parent, const uint64_t process_num)
-    : function_id(_function_id),
-      parent(_parent.get()),
-      last_loc((uint64_t)-1),
-      last_data(nullptr),
-      has_p2p(false),
-      has_collop(false) {}
+    : function_id(_function_id), parent(_parent), has_p2p(false), has_collop(false) {}
 
 tree_node::tree_node(const uint64_t _function_id)
-    : function_id(_function_id),
-      parent(nullptr),
-      last_loc((uint64_t)-1),
-      last_data(nullptr),
-      has_p2p(false),
-      has_collop(false) {}
+    : function_id(_function_id), parent(nullptr), has_p2p(false), has_collop(false) {}
 
 tree_node::~tree_node() {}
 
-// adding data to call path node and saving the location_id and a pointer to the last used section
+// adding data to call path node -> the table keeps the row of the last used location
 // to speed up repeatedly acces to data of the same location (useful on location/stream wise reading of traces
 void tree_node::add_data(const uint64_t location_id, const FunctionData& fdata) {
-    if (last_loc == location_id) {
-        last_data->f_data += fdata;
-    } else {
-        last_loc = location_id;
-
-        auto it = node_data.find(location_id);
-
-        if (it != node_data.end()) {
-            it->second.f_data += fdata;
-
-            last_data = &it->second;
-
-        } else {
-            last_data = &node_data.insert(make_pair(location_id, fdata)).first->second;
-        }
-    }
+    node_data.f_data(node_data.row(location_id)) += fdata;
 }
 
 void tree_node::add_data(const uint64_t location_id, const MessageData& mdata) {
-    if (last_loc == location_id) {
-        last_data->m_data += mdata;
-    } else {
-        last_loc = location_id;
-
-        auto it = node_data.find(location_id);
-
-        if (it != node_data.end()) {
-            it->second.m_data += mdata;
-
-            last_data = &it->second;
-
-        } else {
-            last_data = &node_data.insert(make_pair(location_id, mdata)).first->second;
-        }
-    }
-
-    have_message.insert(make_pair(location_id, &last_data->m_data));
+    node_data.m_data(node_data.row(location_id)) += mdata;
     // TODO workaround
     has_p2p = true;
 }
 
 void tree_node::add_data(const uint64_t location_id, const CollopData& cdata) {
-    if (last_loc == location_id) {
-        last_data->c_data += cdata;
-    } else {
-        last_loc = location_id;
-
-        auto it = node_data.find(location_id);
-
-        if (it != node_data.end()) {
-            it->second.c_data += cdata;
-
-            last_data = &it->second;
-
-        } else {
-            last_data = &node_data.insert(make_pair(location_id, cdata)).first->second;
-        }
-    }
-
-    have_collop.insert(make_pair(location_id, &last_data->c_data));
+    node_data.c_data(node_data.row(location_id)) += cdata;
     // TODO workaround
     has_collop = true;
 }
 
 void tree_node::add_data(const uint64_t location_id, const uint64_t metric_id, const MetricData& metdata) {
-    if (last_loc != location_id) {
-        last_loc = location_id;
+    node_data.set_metric(node_data.row(location_id), metric_id, metdata);
+}
 
-        auto it = node_data.find(location_id);
+MetricData& tree_node::metric(const uint64_t location_id, const uint64_t metric_id, MetricDataType type) {
+    return node_data.metric(node_data.row(location_id), metric_id, type);
+}
 
-        if (it != node_data.end())
-            last_data = &it->second;
-        else
-            last_data = &node_data.insert(make_pair(location_id, NodeData{})).first->second;
-    }
+void tree_node::add_metric_sample(const uint64_t location_id, const MetricSample& sample, bool add) {
+    node_data.add_sample(node_data.row(location_id), sample, add, true);
 
-    last_data->metrics[metric_id] = metdata;
+    if (parent != nullptr)
+        parent->node_data.add_sample(parent->node_data.row(location_id), sample, !add, false);
 }
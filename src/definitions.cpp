@@ -6,38 +6,93 @@
 #include "definitions.h"
 namespace definitions {
 
+// offset 0 is the empty string
+StringTable::StringTable() : chars(1, '\0'), lookup(0, Hash{this}, Equal{this}) { lookup.insert(0); }
+
+// the functors refer to the table they belong to -> the lookup is rebuilt on copies
+StringTable::StringTable(const StringTable& other)
+    : chars(other.chars), lookup(other.lookup.begin(), other.lookup.end(), other.lookup.size(), Hash{this}, Equal{this}) {}
+
+StringTable& StringTable::operator=(const StringTable& other) {
+    if (this != &other) {
+        chars = other.chars;
+        lookup.clear();
+        lookup.insert(other.lookup.begin(), other.lookup.end());
+    }
+
+    return *this;
+}
+
+// FNV-1a
+size_t StringTable::Hash::operator()(uint64_t offset) const {
+    uint64_t hash = 14695981039346656037ULL;
+    for (auto* c = (*table)[{offset}]; *c != '\0'; ++c) {
+        hash ^= static_cast<unsigned char>(*c);
+        hash *= 1099511628211ULL;
+    }
+
+    return static_cast<size_t>(hash);
+}
+
+StringRef StringTable::intern(const char* string, size_t length) {
+    // the string is appended as candidate, a known string removes it again
+    uint64_t offset = chars.size();
+    chars.insert(chars.end(), string, string + length);
+    chars.push_back('\0');
+
+    auto result = lookup.insert(offset);
+    if (!result.second)
+        chars.resize(offset);
+
+    return {*result.first};
+}
+
 SystemIterator SystemTree::begin() const { return SystemIterator(root); }
 
 SystemIterator SystemTree::end() const { return SystemIterator(root, nullptr); }
 
+// nodes deeper than level are folded into their ancestor at level -> location(id) of the copy returns that ancestor
 SystemTree* SystemTree::copy_reduced(const SystemTree& sys_tree, uint32_t level) {
     auto* n_tree = new SystemTree();
 
+    // node of sys_tree -> its copy (or the copy of its ancestor at level)
+    std::map<const SystemNode_t*, SystemNode_t*> copies;
+
     for (auto it = sys_tree.begin(); it != sys_tree.end(); ++it) {
-        if (level >= it->data.level)
-            n_tree->insert_node(*it);
-        else {
-            auto* parent = it->parent;
-            while (parent->data.level > level)
-                parent = parent->parent;  // TODO parent-ception
-
-            auto parent_loc_id = parent->data.location_id;
-            switch (it->data.class_id) {
-                case SystemClass::LOCATION:
-                    n_tree->locations.insert(
-                        std::make_pair(it->data.location_id, n_tree->location_grps[parent_loc_id]));
-                    break;
-                case definitions::SystemClass::LOCATION_GROUP:
-                    n_tree->location_grps.push_back(n_tree->system_nodes[parent_loc_id]);
-                    break;
-
-                default:
-                    n_tree->system_nodes.push_back(n_tree->system_nodes[parent_loc_id]);
-                    break;
-            }
+        const auto* node = &(*it);
+
+        if (it->data.level > level) {
+            copies[node] = copies[it->parent];
+            continue;
         }
+
+        auto* parent   = it->parent != nullptr ? copies[it->parent] : nullptr;
+        auto  new_node = std::make_shared<SystemNode_t>(SystemNode_t(parent, {}, it->data));
+
+        if (parent != nullptr)
+            parent->children.insert(std::make_pair(it->data.node_id, new_node));
+        else
+            n_tree->root = new_node;
+
+        if (it->data.level < n_tree->num_nodes_per_level.size())
+            ++n_tree->num_nodes_per_level[it->data.level];
+        else
+            n_tree->num_nodes_per_level.push_back(1);
+
+        ++n_tree->_size;
+        copies[node] = new_node.get();
     }
 
+    // same positions as in sys_tree -> ids of the trace still work as index
+    for (auto* node : sys_tree.system_nodes)
+        n_tree->system_nodes.push_back(copies[node]);
+
+    for (auto* node : sys_tree.location_grps)
+        n_tree->location_grps.push_back(copies[node]);
+
+    for (const auto& location : sys_tree.locations)
+        n_tree->locations.insert(std::make_pair(location.first, copies[location.second]));
+
     return n_tree;
 }
 }  // namespace definitions
@@ -0,0 +1,58 @@
+/*
+ This is part of the OTF-Profiler. Copyright by ZIH, TU Dresden 2016-2018.
+ Authors: Maximillian Neumann, Denis Hünich, Jens Doleschal
+*/
+
+#include "metric_slots.h"
+
+using namespace std;
+
+uint32_t MetricLayout::add_metric(uint64_t metric_id, MetricDataType type) {
+    auto it = metric_slots.find(metric_id);
+    if (it != metric_slots.end())
+        return it->second.slot;
+
+    auto& slots = slot_metric[metric_type_index(type)];
+    auto  slot  = static_cast<uint32_t>(slots.size());
+
+    slots.push_back(metric_id);
+    metric_slots.insert(make_pair(metric_id, SlotRef{type, slot}));
+
+    return slot;
+}
+
+void MetricLayout::add_class(uint64_t class_id, const vector<pair<uint8_t, uint64_t>>& members) {
+    if (class_id >= classes.size())
+        classes.resize(class_id + 1);
+
+    auto& metric_class = classes[class_id];
+    if (!metric_class.defined) {
+        metric_class.defined = true;
+        ++num_defined;
+    }
+
+    for (const auto& member : members) {
+        auto it = metric_slots.find(member.second);
+        if (it == metric_slots.end())
+            continue;
+
+        auto& typed = metric_class.members[metric_type_index(it->second.type)];
+
+        if (!typed.slots.empty() && typed.slots.back() + 1 != it->second.slot)
+            typed.contiguous = false;
+
+        typed.slots.push_back(it->second.slot);
+        typed.positions.push_back(member.first);
+    }
+}
+
+bool MetricLayout::find(uint64_t metric_id, MetricDataType& type, uint32_t& slot) const {
+    auto it = metric_slots.find(metric_id);
+    if (it == metric_slots.end())
+        return false;
+
+    type = it->second.type;
+    slot = it->second.slot;
+
+    return true;
+}
@@ -0,0 +1,460 @@
+/*
+ This is part of the OTF-Profiler. Copyright by ZIH, TU Dresden 2016-2018.
+ Authors: Maximillian Neumann, Denis Hünich, Jens Doleschal
+*/
+
+#include "node_data.h"
+
+#include <algorithm>
+
+using namespace std;
+
+const uint32_t    LocationIndex::npos;
+const size_t      NodeDataTable::npos;
+const MessageData NodeDataTable::no_messages{};
+const CollopData  NodeDataTable::no_collops{};
+
+LocationIndex::LocationIndex(vector<uint64_t> location_ids) : ids(move(location_ids)) {
+    sort(ids.begin(), ids.end());
+    ids.erase(unique(ids.begin(), ids.end()), ids.end());
+
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (ids[i] != i) {
+            identity = false;
+            break;
+        }
+    }
+
+    if (!identity) {
+        indices.reserve(ids.size());
+        for (size_t i = 0; i < ids.size(); ++i)
+            indices.insert(make_pair(ids[i], static_cast<uint32_t>(i)));
+    }
+}
+
+size_t NodeDataTable::find(uint64_t location_id) const {
+    if (location_id == last_location)
+        return last_row;
+
+    if (dense) {
+        auto i = index->index(location_id);
+        return (i != LocationIndex::npos && present[i]) ? i : npos;
+    }
+
+    auto it = lower_bound(row_location.begin(), row_location.end(), location_id);
+    if (it == row_location.end() || *it != location_id)
+        return npos;
+
+    return it - row_location.begin();
+}
+
+size_t NodeDataTable::row(uint64_t location_id) {
+    if (location_id == last_location)
+        return last_row;
+
+    size_t r;
+    if (dense) {
+        auto i = index->index(location_id);
+        if (i == LocationIndex::npos) {
+            // location unknown to the index -> only a sparse table can hold it
+            make_sparse();
+            return row(location_id);
+        }
+
+        if (!present[i]) {
+            present[i] = true;
+            ++num_dense;
+        }
+
+        r = i;
+    } else {
+        // locations are mostly read in ascending order -> a new last row is appended without a search
+        auto it = !row_location.empty() && location_id > row_location.back()
+                      ? row_location.end()
+                      : lower_bound(row_location.begin(), row_location.end(), location_id);
+        r = it - row_location.begin();
+
+        if (it == row_location.end() || *it != location_id) {
+            if (index != nullptr && row_location.size() + 1 >= dense_threshold() &&
+                index->index(location_id) != LocationIndex::npos && make_dense())
+                return row(location_id);
+
+            insert_row(r, location_id);
+        }
+    }
+
+    last_location = location_id;
+    last_row      = r;
+
+    return r;
+}
+
+MetricData& NodeDataTable::metric(size_t row, uint64_t metric_id, MetricDataType type) {
+    for (auto& column : metric_columns) {
+        if (column.metric_id == metric_id) {
+            if (!column.present[row]) {
+                column.present[row] = true;
+                column.data[row]    = MetricData{type, {}, {}};
+            }
+
+            return column.data[row];
+        }
+    }
+
+    metric_columns.push_back(
+        {metric_id, vector<MetricData>(f.size(), MetricData{type, {}, {}}), vector<bool>(f.size())});
+    metric_columns.back().present[row] = true;
+
+    return metric_columns.back().data[row];
+}
+
+void NodeDataTable::set_metric(size_t row, uint64_t metric_id, const MetricData& metdata) {
+    MetricDataType type;
+    uint32_t       slot;
+
+    if (layout == nullptr || !layout->find(metric_id, type, slot) || type != metdata.type) {
+        metric(row, metric_id, metdata.type) = metdata;
+        return;
+    }
+
+    allocate_slots();
+    slot_present[row * layout->num_slots() + layout->offset(type) + slot] = true;
+
+    auto u_width = layout->width(MetricDataType::UINT64);
+    auto s_width = layout->width(MetricDataType::INT64);
+    auto d_width = layout->width(MetricDataType::DOUBLE);
+
+    switch (type) {
+        case MetricDataType::UINT64:
+            slots_u.incl[row * u_width + slot] = metdata.data_incl.u;
+            slots_u.excl[row * u_width + slot] = metdata.data_excl.u;
+            break;
+        case MetricDataType::INT64:
+            slots_s.incl[row * s_width + slot] = metdata.data_incl.s;
+            slots_s.excl[row * s_width + slot] = metdata.data_excl.s;
+            break;
+        case MetricDataType::DOUBLE:
+            slots_d.incl[row * d_width + slot] = metdata.data_incl.d;
+            slots_d.excl[row * d_width + slot] = metdata.data_excl.d;
+            break;
+    }
+}
+
+template <typename T>
+void NodeDataTable::apply_sample(size_t row, const MetricSample& sample, const MetricLayout::Class& metric_class,
+                                 bool add, bool inclusive) {
+    const auto& members = metric_class.of<T>();
+    if (members.slots.empty())
+        return;
+
+    auto&       column = slots<T>();
+    const auto& values = sample.values<T>();
+    auto        width  = layout->width(metric_slot_type<T>::type);
+    auto*       incl   = column.incl.data() + row * width;
+    auto*       excl   = column.excl.data() + row * width;
+
+    if (members.contiguous) {
+        auto first = members.slots.front();
+        auto n     = members.slots.size();
+
+        if (add) {
+            if (inclusive)
+                metric_kernel::add(incl + first, values.data() + first, n);
+            metric_kernel::add(excl + first, values.data() + first, n);
+        } else {
+            if (inclusive)
+                metric_kernel::sub(incl + first, values.data() + first, n);
+            metric_kernel::sub(excl + first, values.data() + first, n);
+        }
+    } else {
+        for (auto slot : members.slots) {
+            if (add) {
+                if (inclusive)
+                    incl[slot] += values[slot];
+                excl[slot] += values[slot];
+            } else {
+                if (inclusive)
+                    incl[slot] -= values[slot];
+                excl[slot] -= values[slot];
+            }
+        }
+    }
+
+    auto present = slot_present.begin() + row * layout->num_slots() + layout->offset(metric_slot_type<T>::type);
+    for (auto slot : members.slots)
+        present[slot] = true;
+}
+
+void NodeDataTable::add_sample(size_t row, const MetricSample& sample, bool add, bool inclusive) {
+    assert(layout != nullptr);
+    allocate_slots();
+
+    for (const auto* metric_class : sample.classes()) {
+        apply_sample<uint64_t>(row, sample, *metric_class, add, inclusive);
+        apply_sample<int64_t>(row, sample, *metric_class, add, inclusive);
+        apply_sample<double>(row, sample, *metric_class, add, inclusive);
+    }
+}
+
+void NodeDataTable::allocate_slots() {
+    if (!slot_present.empty() || layout == nullptr || layout->empty())
+        return;
+
+    auto rows = f.size();
+
+    slots_u.incl.assign(rows * layout->width(MetricDataType::UINT64), 0);
+    slots_u.excl.assign(rows * layout->width(MetricDataType::UINT64), 0);
+    slots_s.incl.assign(rows * layout->width(MetricDataType::INT64), 0);
+    slots_s.excl.assign(rows * layout->width(MetricDataType::INT64), 0);
+    slots_d.incl.assign(rows * layout->width(MetricDataType::DOUBLE), 0);
+    slots_d.excl.assign(rows * layout->width(MetricDataType::DOUBLE), 0);
+    slot_present.assign(rows * layout->num_slots(), false);
+}
+
+pair<uint64_t, MetricData> NodeDataTable::slot_metric(size_t row, size_t slot) const {
+    MetricData metdata;
+
+    auto u_width = layout->width(MetricDataType::UINT64);
+    auto s_width = layout->width(MetricDataType::INT64);
+    auto d_width = layout->width(MetricDataType::DOUBLE);
+
+    if (slot < u_width) {
+        metdata.type      = MetricDataType::UINT64;
+        metdata.data_incl = slots_u.incl[row * u_width + slot];
+        metdata.data_excl = slots_u.excl[row * u_width + slot];
+    } else if (slot < u_width + s_width) {
+        slot -= u_width;
+        metdata.type      = MetricDataType::INT64;
+        metdata.data_incl = slots_s.incl[row * s_width + slot];
+        metdata.data_excl = slots_s.excl[row * s_width + slot];
+    } else {
+        slot -= u_width + s_width;
+        metdata.type      = MetricDataType::DOUBLE;
+        metdata.data_incl = slots_d.incl[row * d_width + slot];
+        metdata.data_excl = slots_d.excl[row * d_width + slot];
+    }
+
+    return make_pair(layout->metric_id(metdata.type, static_cast<uint32_t>(slot)), metdata);
+}
+
+template <typename T>
+void NodeDataTable::insert_slots(size_t pos) {
+    auto& column = slots<T>();
+    auto  width  = layout->width(metric_slot_type<T>::type);
+
+    column.incl.insert(column.incl.begin() + pos * width, width, T{});
+    column.excl.insert(column.excl.begin() + pos * width, width, T{});
+}
+
+template <typename T>
+void NodeDataTable::copy_slots(const NodeDataTable& src, size_t src_row, size_t dst_row) {
+    const auto& from  = src.slots<T>();
+    auto&       to    = slots<T>();
+    auto        width = layout->width(metric_slot_type<T>::type);
+
+    copy(from.incl.begin() + src_row * width, from.incl.begin() + (src_row + 1) * width,
+         to.incl.begin() + dst_row * width);
+    copy(from.excl.begin() + src_row * width, from.excl.begin() + (src_row + 1) * width,
+         to.excl.begin() + dst_row * width);
+}
+
+NodeDataTable::Entry NodeDataTable::entry(size_t row) const {
+    return Entry{dense ? index->location(row) : row_location[row],
+                 Row{f[row], m.empty() ? no_messages : m[row], c.empty() ? no_collops : c[row], MetricsView(this, row)},
+                 row};
+}
+
+void NodeDataTable::insert_row(size_t pos, uint64_t location_id) {
+    row_location.insert(row_location.begin() + pos, location_id);
+    f.insert(f.begin() + pos, FunctionData{});
+
+    if (!m.empty())
+        m.insert(m.begin() + pos, MessageData{});
+
+    if (!c.empty())
+        c.insert(c.begin() + pos, CollopData{});
+
+    for (auto& column : metric_columns) {
+        column.data.insert(column.data.begin() + pos, MetricData{});
+        column.present.insert(column.present.begin() + pos, false);
+    }
+
+    if (!slot_present.empty()) {
+        insert_slots<uint64_t>(pos);
+        insert_slots<int64_t>(pos);
+        insert_slots<double>(pos);
+
+        slot_present.insert(slot_present.begin() + pos * layout->num_slots(), layout->num_slots(), false);
+    }
+}
+
+void NodeDataTable::copy_row(const NodeDataTable& src, size_t src_row, size_t dst_row) {
+    f[dst_row] = src.f[src_row];
+
+    if (!src.m.empty())
+        m_data(dst_row) = src.m[src_row];
+
+    if (!src.c.empty())
+        c_data(dst_row) = src.c[src_row];
+
+    for (const auto& column : src.metric_columns)
+        if (column.present[src_row])
+            metric(dst_row, column.metric_id, column.data[src_row].type) = column.data[src_row];
+
+    if (src.slot_present.empty())
+        return;
+
+    if (src.layout != layout) {
+        // other layout -> slot by slot via the metric ids
+        auto slots = src.layout->num_slots();
+        for (size_t slot = 0; slot < slots; ++slot) {
+            if (src.slot_present[src_row * slots + slot]) {
+                auto metric = src.slot_metric(src_row, slot);
+                set_metric(dst_row, metric.first, metric.second);
+            }
+        }
+
+        return;
+    }
+
+    allocate_slots();
+    copy_slots<uint64_t>(src, src_row, dst_row);
+    copy_slots<int64_t>(src, src_row, dst_row);
+    copy_slots<double>(src, src_row, dst_row);
+
+    auto slots = layout->num_slots();
+    copy(src.slot_present.begin() + src_row * slots, src.slot_present.begin() + (src_row + 1) * slots,
+         slot_present.begin() + dst_row * slots);
+}
+
+// moves all rows to their dense position, false if a location is unknown to the index
+bool NodeDataTable::make_dense() {
+    for (auto location : row_location)
+        if (index->index(location) == LocationIndex::npos)
+            return false;
+
+    NodeDataTable dense_table;
+    dense_table.index     = index;
+    dense_table.layout    = layout;
+    dense_table.dense     = true;
+    dense_table.num_dense = row_location.size();
+    dense_table.present.assign(index->size(), false);
+    dense_table.f.assign(index->size(), FunctionData{});
+
+    for (size_t r = 0; r < row_location.size(); ++r) {
+        auto i                  = index->index(row_location[r]);
+        dense_table.present[i] = true;
+        dense_table.copy_row(*this, r, i);
+    }
+
+    *this = move(dense_table);
+
+    return true;
+}
+
+void NodeDataTable::make_sparse() {
+    NodeDataTable sparse_table;
+    sparse_table.index  = index;
+    sparse_table.layout = layout;
+    sparse_table.row_location.reserve(num_dense);
+    sparse_table.f.reserve(num_dense);
+
+    for (size_t i = 0; i < f.size(); ++i) {
+        if (!present[i])
+            continue;
+
+        sparse_table.insert_row(sparse_table.f.size(), index->location(i));
+        sparse_table.copy_row(*this, i, sparse_table.f.size() - 1);
+    }
+
+    *this = move(sparse_table);
+}
+
+void NodeDataTable::merge(const NodeDataTable& rhs) {
+    if (rhs.empty())
+        return;
+
+    if (empty() && index == rhs.index && layout == rhs.layout) {
+        *this         = rhs;
+        last_location = static_cast<uint64_t>(-1);
+        last_row      = npos;
+        return;
+    }
+
+    if (!dense && index != nullptr && size() + rhs.size() >= dense_threshold())
+        make_dense();
+
+    last_location = static_cast<uint64_t>(-1);
+    last_row      = npos;
+
+    if (dense) {
+        for (const auto& data : rhs) {
+            if (find(data.first) != npos)
+                continue;
+
+            copy_row(rhs, data.row, row(data.first));
+        }
+
+        return;
+    }
+
+    // both sparse -> merge the sorted rows instead of inserting one by one
+    NodeDataTable merged;
+    merged.index  = index;
+    merged.layout = layout;
+    merged.row_location.reserve(size() + rhs.size());
+    merged.f.reserve(size() + rhs.size());
+
+    auto lhs_it = begin();
+    auto rhs_it = rhs.begin();
+    while (lhs_it != end() || rhs_it != rhs.end()) {
+        bool take_lhs = rhs_it == rhs.end() || (lhs_it != end() && (*lhs_it).first <= (*rhs_it).first);
+
+        const auto& src  = take_lhs ? *this : rhs;
+        auto        data = take_lhs ? *lhs_it : *rhs_it;
+
+        merged.insert_row(merged.f.size(), data.first);
+        merged.copy_row(src, data.row, merged.f.size() - 1);
+
+        // same location in both -> lhs wins
+        if (take_lhs && rhs_it != rhs.end() && (*rhs_it).first == data.first)
+            ++rhs_it;
+
+        if (take_lhs)
+            ++lhs_it;
+        else
+            ++rhs_it;
+    }
+
+    *this = move(merged);
+}
+
+void NodeDataTable::merge(NodeDataTable&& rhs) {
+    if (empty() && index == rhs.index && layout == rhs.layout) {
+        *this         = move(rhs);
+        last_location = static_cast<uint64_t>(-1);
+        last_row      = npos;
+    } else
+        merge(static_cast<const NodeDataTable&>(rhs));
+
+    // the columns of rhs are freed, not only cleared
+    NodeDataTable released;
+    released.index  = rhs.index;
+    released.layout = rhs.layout;
+    rhs             = move(released);
+}
+
+size_t NodeDataTable::allocated_bytes() const {
+    size_t bytes = row_location.capacity() * sizeof(uint64_t) + present.capacity() / 8 +
+                   f.capacity() * sizeof(FunctionData) + m.capacity() * sizeof(MessageData) +
+                   c.capacity() * sizeof(CollopData);
+
+    for (const auto& column : metric_columns)
+        bytes += sizeof(MetricColumn) + column.data.capacity() * sizeof(MetricData) + column.present.capacity() / 8;
+
+    bytes += (slots_u.incl.capacity() + slots_u.excl.capacity()) * sizeof(uint64_t) +
+             (slots_s.incl.capacity() + slots_s.excl.capacity()) * sizeof(int64_t) +
+             (slots_d.incl.capacity() + slots_d.excl.capacity()) * sizeof(double) + slot_present.capacity() / 8;
+
+    return bytes;
+}
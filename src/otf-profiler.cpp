@@ -4,7 +4,12 @@
 */
 
 #include "otf-profiler.h"
+#include <atomic>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
 #include "tracereader.h"
 #include "utils.h"
 
@@ -41,44 +46,8 @@ int error() {
     return 1;
 }
 
-int main(int argc, char** argv) {
-#ifdef OTFPROFILER_MPI
-    /* start MPI */
-
-    int my_rank;
-    int num_ranks;
-
-    MPI_Init(&argc, &argv);
-
-    MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
-
-    AllData alldata(my_rank, num_ranks);
-#else  /* OTFPROFILER_MPI */
-    AllData alldata(0, 1);
-#endif /* OTFPROFILER_MPI */
-    /* step 0: parse command line options */
-    if (!alldata.params.parseCommandLine(argc, argv))
-        return error();
-
-    // check if library for set flags are available
-    if (!alldata.params.output_type_set) {
-        std::cerr << "ERROR: No supported output type set. See --help for output options.";
-        return 1;
-    } else if (alldata.params.create_cube) {
-#ifndef HAVE_CUBE
-        std::cerr << "ERROR: No cube library found" << std::endl;
-        return 1;
-#endif
-
-    } else if (alldata.params.create_json) {
-#ifndef HAVE_JSON
-        std::cerr << "ERROR: No json library found" << std::endl;
-        return 1;
-#endif
-    }
-
-    /* registers all scopes for time measurement depending on the verbose level */
+/* registers all scopes for time measurement depending on the verbose level */
+static void registerScopes(AllData& alldata) {
     if (alldata.params.verbose_level > 0)
         alldata.tm.registerScope(ScopeID::TOTAL, "Total time");
 
@@ -90,7 +59,13 @@ int main(int argc, char** argv) {
         alldata.tm.registerScope(ScopeID::DOT, "DOT creation process");
         alldata.tm.registerScope(ScopeID::JSON, "JSON data output creation process");
     }
+}
 
+// serializes readers that keep their state in file-static variables when traces are profiled in parallel
+static std::mutex non_reentrant_reader_mutex;
+
+/* profiles the trace alldata.params.input_file_name and writes all requested outputs */
+static bool profileTrace(AllData& alldata) {
     /* starts runtime measurement for total time */
     alldata.tm.start(ScopeID::TOTAL);
 
@@ -103,15 +78,29 @@ int main(int argc, char** argv) {
     unique_ptr<TraceReader> reader = getTraceReader(alldata);
 
     if (reader == nullptr)
-        return error();
+        return false;
 
-    if (!reader->initialize(alldata) ||
-        !reader->readDefinitions(alldata) ||
-        !reader->readEvents(alldata) ||
-        !reader->readStatistics(alldata))
-        return error();
+    {
+        std::unique_lock<std::mutex> lock(non_reentrant_reader_mutex, std::defer_lock);
+        if (!reader->isReentrant())
+            lock.lock();
+
+        if (!reader->initialize(alldata) || !reader->readDefinitions(alldata))
+            return false;
+
+        // dense node data needs all locations of the trace
+        alldata.call_path_tree.set_locations(alldata.definitions.system_tree.location_ids());
+
+        if (!reader->readEvents(alldata) || !reader->readStatistics(alldata))
+            return false;
 
-    reader.reset(nullptr);
+        reader.reset(nullptr);
+    }
+
+    alldata.verbosePrint(2, false,
+                         "call path tree: " + std::to_string(alldata.call_path_tree.num_nodes()) + " nodes, " +
+                             std::to_string(alldata.call_path_tree.allocated_bytes() / 1024) + " KiB node storage, " +
+                             std::to_string(alldata.call_path_tree.node_data_bytes() / 1024) + " KiB node data");
 #ifdef OTFPROFILER_MPI
     MPI_Barrier(MPI_COMM_WORLD);
 #endif /* OTFPROFILER_MPI */
@@ -126,18 +115,27 @@ int main(int argc, char** argv) {
         MPI_Barrier(MPI_COMM_WORLD);
         alldata.tm.start(ScopeID::REDUCE);
         if (!ReduceData(alldata))
-            return error();
+            return false;
         MPI_Barrier(MPI_COMM_WORLD);
         alldata.tm.stop(ScopeID::REDUCE);
     }
 #endif /* OTFPROFILER_MPI */
 
+    // the tree does not change any more -> outputs iterate the pre-order index
+    alldata.call_path_tree.freeze();
+
+    // statistics per call path for JSON and DOT -> already built by the reduction if only those are requested
+    if ((alldata.params.create_json || alldata.params.create_dot) && alldata.summary == nullptr)
+        alldata.summary =
+            std::make_shared<TreeSummary>(TreeSummary::of_tree(alldata.call_path_tree, alldata.definitions));
+
 #ifdef HAVE_CUBE
+    // the cube report is written in the background while the other outputs are created
+    std::future<bool> cube_written;
     if (alldata.params.create_cube) {
         /* step 6.3: create CUBE output */
         alldata.tm.start(ScopeID::CUBE);
-        CreateCube(alldata);
-        alldata.tm.stop(ScopeID::CUBE);
+        cube_written = CreateCube(alldata);
     }
 #endif
 
@@ -164,6 +162,14 @@ if (alldata.params.create_dot) {
         alldata.tm.stop(ScopeID::JSON);
     }
 #endif
+
+#ifdef HAVE_CUBE
+    // the CUBE scope ends with the background write, it overlaps the scopes of the other outputs
+    if (cube_written.valid()) {
+        cube_written.get();
+        alldata.tm.stop(ScopeID::CUBE);
+    }
+#endif
     alldata.tm.stop(ScopeID::TOTAL);
 #ifdef SHOW_RESULTS
     /* step 6.3: show result data on stdout */
@@ -177,6 +183,136 @@ if (alldata.params.create_dot) {
         alldata.tm.printAll();
     }
 
+    return true;
+}
+
+/* profiles every trace of the batch list file
+   -> one trace per line: <input file> [<output prefix>], default prefix is <-o prefix>_<number of the trace> */
+static bool profileBatch(AllData& alldata) {
+    std::ifstream list(alldata.params.batch_file);
+    if (!list) {
+        std::cerr << "ERROR: Could not open batch file '" << alldata.params.batch_file << "'" << std::endl;
+        return false;
+    }
+
+    std::vector<std::pair<std::string, std::string>> traces;
+    std::string                                      line;
+    while (std::getline(list, line)) {
+        std::istringstream entry(line);
+        std::string        input, prefix;
+
+        if (!(entry >> input) || input[0] == '#')
+            continue;
+
+        if (!(entry >> prefix))
+            prefix = alldata.params.output_file_prefix + "_" + std::to_string(traces.size());
+
+        traces.push_back({input, prefix});
+    }
+
+    uint32_t jobs = std::max<uint32_t>(1, std::min<size_t>(alldata.params.batch_jobs, traces.size()));
+#ifdef OTFPROFILER_MPI
+    // all ranks take part in every trace -> the collective operations must happen in the same order
+    jobs = 1;
+#endif /* OTFPROFILER_MPI */
+
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> failed{0};
+
+    auto worker = [&]() {
+        for (auto pos = next++; pos < traces.size(); pos = next++) {
+            // a fresh AllData per trace -> nothing is shared between two traces
+            AllData trace_data(alldata.metaData.myRank, alldata.metaData.numRanks);
+            trace_data.params                    = alldata.params;
+            trace_data.params.input_file_name    = traces[pos].first;
+            trace_data.params.output_file_prefix = traces[pos].second;
+            registerScopes(trace_data);
+
+            trace_data.verbosePrint(1, true, "batch: profiling " + traces[pos].first + " -> " + traces[pos].second);
+
+            if (!profileTrace(trace_data)) {
+                std::cerr << "ERROR: Could not profile " << traces[pos].first << std::endl;
+#ifdef OTFPROFILER_MPI
+                // the other ranks would wait forever in the next collective operation
+                error();
+#endif /* OTFPROFILER_MPI */
+                ++failed;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < jobs; ++i)
+        threads.emplace_back(worker);
+
+    worker();
+
+    for (auto& thread : threads)
+        thread.join();
+
+    alldata.verbosePrint(1, true,
+                         "batch: " + std::to_string(traces.size() - failed) + " of " + std::to_string(traces.size()) +
+                             " traces profiled");
+
+    return failed == 0;
+}
+
+int main(int argc, char** argv) {
+#ifdef OTFPROFILER_MPI
+    /* start MPI */
+
+    int my_rank;
+    int num_ranks;
+    int thread_support;
+
+    // reader threads claim locations one at a time -> MPI calls are serialized, but not from the main thread only
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_SERIALIZED, &thread_support);
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+
+    AllData alldata(my_rank, num_ranks);
+#else  /* OTFPROFILER_MPI */
+    AllData alldata(0, 1);
+#endif /* OTFPROFILER_MPI */
+    /* step 0: parse command line options */
+    if (!alldata.params.parseCommandLine(argc, argv))
+        return error();
+
+#ifdef OTFPROFILER_MPI
+    if (alldata.params.num_threads > 1 && thread_support < MPI_THREAD_SERIALIZED) {
+        alldata.verbosePrint(0, true, "Warning: MPI library without thread support, reading with one thread per rank");
+        alldata.params.num_threads = 1;
+    }
+#endif /* OTFPROFILER_MPI */
+
+    // check if library for set flags are available
+    if (!alldata.params.output_type_set) {
+        std::cerr << "ERROR: No supported output type set. See --help for output options.";
+        return 1;
+    } else if (alldata.params.create_cube) {
+#ifndef HAVE_CUBE
+        std::cerr << "ERROR: No cube library found" << std::endl;
+        return 1;
+#endif
+
+    } else if (alldata.params.create_json) {
+#ifndef HAVE_JSON
+        std::cerr << "ERROR: No json library found" << std::endl;
+        return 1;
+#endif
+    }
+
+    if (!alldata.params.batch_file.empty()) {
+        if (!profileBatch(alldata))
+            return error();
+    } else {
+        registerScopes(alldata);
+
+        if (!profileTrace(alldata))
+            return error();
+    }
+
     alldata.verbosePrint(1, true, "done");
 
 #ifdef OTFPROFILER_MPI
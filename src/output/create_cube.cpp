@@ -3,6 +3,7 @@
  Authors: Maximillian Neumann, Denis Hünich, Jens Doleschal
 */
 
+#include <deque>
 #include <fstream>
 #include <map>
 
@@ -17,8 +18,8 @@ using namespace std;
 using SystemNode_t = typename definitions::SystemTree::SystemNode_t;
 
 template <typename T>
-typename std::map<uint64_t, T>::iterator find_in(std::map<uint64_t, T> obj, uint64_t id, const string& err_file,
-                                                 const int err_line) {
+typename std::map<uint64_t, T>::const_iterator find_in(const std::map<uint64_t, T>& obj, uint64_t id,
+                                                       const string& err_file, const int err_line) {
     auto res = obj.find(id);
     if (res != obj.end())
         return res;
@@ -27,12 +28,59 @@ typename std::map<uint64_t, T>::iterator find_in(std::map<uint64_t, T> obj, uint
         exit(1);
     }
 }
+// rows of the node data staged per block of the severity fill
+static const size_t block_rows = 64 * 1024;
+
+// severity of a (metric, cnode, thread) -> computed in parallel, set by one thread
+struct Severity {
+    cube::Metric*    metric;
+    cube::Thread*    thread;
+    MetricDataType   type;
+    MetricData::Data value;
+};
+
+// severities of a range of call path nodes
+struct SeverityBlock {
+    std::vector<Severity>                  severities;
+    std::vector<std::pair<size_t, size_t>> nodes;  // <pre-order index, end of its severities>
+};
+
+// depth of the system tree nodes of a cube level, -1 -> every location is a thread
+static uint32_t level_depth(definitions::SystemTree& system_tree, CubeLevel level) {
+    if (level == CubeLevel::LOCATION)
+        return static_cast<uint32_t>(-1);
+
+    if (level == CubeLevel::MACHINE)
+        return 0;
+
+    // processes are the location groups, nodes their parents -> the first group of the tree, whatever its id
+    const definitions::SystemTree::SystemNode_t* group = nullptr;
+    if (system_tree.get_root() != nullptr)
+        for (auto it = system_tree.begin(); it != system_tree.end(); ++it)
+            if (it->data.class_id == definitions::SystemClass::LOCATION_GROUP) {
+                group = &*it;
+                break;
+            }
+
+    if (group == nullptr) {
+        cerr << "Warning: no location group in the system tree, the CUBE profile has one thread per location" << endl;
+        return static_cast<uint32_t>(-1);
+    }
+
+    if (level == CubeLevel::PROCESS || group->parent == nullptr)
+        return group->data.level;
+
+    return group->parent->data.level;
+}
+
 // #define FIND(map,id) find_in(map,id,__FILE__, __LINE__)
 #define FIND(...) find_in(__VA_ARGS__, __FILE__, __LINE__)
 
-bool CreateCube(AllData& alldata) {
+std::future<bool> CreateCube(AllData& alldata) {
     if (alldata.metaData.myRank != 0 /*&& !alldata.params.no_reduce*/) {
-        return true;
+        std::promise<bool> done;
+        done.set_value(true);
+        return done.get_future();
     } /* else if ( alldata.params.no_reduce ) { //TODO no_reduce für ausgabe von teil-cubes?
 
              StartMeasurement(alldata, 1, true, "produce cube output");
@@ -41,15 +89,25 @@ bool CreateCube(AllData& alldata) {
 
     alldata.verbosePrint(1, true, "producing cube output");
 
-    cube::Cube cube_out;
+    auto cube_out = std::make_shared<cube::Cube>();
 
     map<SystemNode_t*, cube::Node*>    MapCubeNodes;
     map<SystemNode_t*, cube::Process*> MapCubeProcesses;
     map<SystemNode_t*, cube::Thread*>  MapCubeThreads;
 
-    map<uint64_t, cube::Metric*>  MapCubeMetrics;
-    map<uint64_t, cube::Region*>  MapCubeRegions;
-    map<tree_node*, cube::Cnode*> MapCubeCnodes;
+    map<uint64_t, cube::Metric*> MapCubeMetrics;
+    map<uint64_t, cube::Region*> MapCubeRegions;
+
+    // handles of a call path node, indexed by the pre-order index of the tree
+    struct NodeHandles {
+        cube::Cnode*  cnode;
+        cube::Metric* occ;   // metrics of the paradigm of the region, nullptr if the region is unknown
+        cube::Metric* time;
+    };
+
+    alldata.call_path_tree.freeze();
+    const auto&         traversal = alldata.call_path_tree.traversal();
+    vector<NodeHandles> cnodes(traversal.size());
 
     bool have_p2p    = false;
     bool have_collop = false;
@@ -60,39 +118,59 @@ bool CreateCube(AllData& alldata) {
     uint64_t                p2p_start;
     uint64_t                collop_start;
 
+    // --cube-level -> the nodes at depth cut get one thread each, the locations below are folded into it
+    auto*                                    system_tree = &alldata.definitions.system_tree;
+    std::unique_ptr<definitions::SystemTree> reduced_tree;
+    uint32_t                                 cut       = level_depth(*system_tree, alldata.params.cube_level);
+    bool                                     aggregate = cut != static_cast<uint32_t>(-1);
+    if (aggregate) {
+        reduced_tree = system_tree->reduced(cut);
+        system_tree  = reduced_tree.get();
+    }
+
     // systemtree engage!
     string name, class_name;
 
-    for (auto it = alldata.definitions.system_tree.begin(); it != alldata.definitions.system_tree.end(); ++it) {
+    for (auto it = system_tree->begin(); it != system_tree->end(); ++it) {
         auto* node = &(*it);
         auto& data = it->data;
         switch (it->data.class_id) {
             case definitions::SystemClass::LOCATION:
-                MapCubeThreads[node] = cube_out.def_location(
+                MapCubeThreads[node] = cube_out->def_location(
                     data.name, data.node_id, cube::CUBE_LOCATION_TYPE_CPU_THREAD, MapCubeProcesses[it->parent]);
                 break;
             case definitions::SystemClass::MACHINE:
-                MapCubeNodes[node] = cube_out.def_mach(data.name, "");
+                MapCubeNodes[node] = cube_out->def_mach(data.name, "");
                 break;
             case definitions::SystemClass::LOCATION_GROUP:
-                MapCubeProcesses[node] = cube_out.def_location_group(
+                MapCubeProcesses[node] = cube_out->def_location_group(
                     data.name, data.node_id, cube::CUBE_LOCATION_GROUP_TYPE_PROCESS, MapCubeNodes[it->parent]);
                 break;
             default:
-                MapCubeNodes[node] = cube_out.def_system_tree_node(data.name, "", "node", MapCubeNodes[it->parent]);
+                MapCubeNodes[node] = cube_out->def_system_tree_node(data.name, "", "node", MapCubeNodes[it->parent]);
                 break;
         }
+
+        if (aggregate && data.level == cut && data.class_id != definitions::SystemClass::LOCATION) {
+            auto* group = data.class_id == definitions::SystemClass::LOCATION_GROUP
+                              ? MapCubeProcesses[node]
+                              : cube_out->def_location_group(data.name, data.node_id,
+                                                             cube::CUBE_LOCATION_GROUP_TYPE_PROCESS, MapCubeNodes[node]);
+
+            MapCubeThreads[node] =
+                cube_out->def_location(data.name, data.node_id, cube::CUBE_LOCATION_TYPE_CPU_THREAD, group);
+        }
     }
     // systemtree end
 
     // cube-metrics engage!
     // implizite annahme dass function_data da ist (IMMER)
     MapCubeMetrics[0] =
-        cube_out.def_met("Visits", "met_visits", "UINT64", "occ", "", "",
+        cube_out->def_met("Visits", "met_visits", "UINT64", "occ", "", "",
                          "display function occurrence for each functiongroup", NULL, cube::CUBE_METRIC_EXCLUSIVE);
 
     MapCubeMetrics[1] =
-        cube_out.def_met("Time", "met_time", "DOUBLE", "sec", "", "",
+        cube_out->def_met("Time", "met_time", "DOUBLE", "sec", "", "",
                          "display function exclusive time for each functiongroup", NULL, cube::CUBE_METRIC_EXCLUSIVE);
 
     string met_visits = "Met_Visits";
@@ -103,7 +181,7 @@ bool CreateCube(AllData& alldata) {
         auto insert_check = paradigmToCubeMetric_occ.insert(make_pair(paradigm.first, id)).second;
         if (insert_check) {
             auto metric        = FIND(MapCubeMetrics, 0)->second;
-            MapCubeMetrics[id] = cube_out.def_met(paradigm.second.name, paradigm.second.name, "UINT64", "occ", "", "",
+            MapCubeMetrics[id] = cube_out->def_met(paradigm.second.name, paradigm.second.name, "UINT64", "occ", "", "",
                                                   "", metric, cube::CUBE_METRIC_EXCLUSIVE);
         }
 
@@ -111,7 +189,7 @@ bool CreateCube(AllData& alldata) {
         insert_check = paradigmToCubeMetric_time.insert(make_pair(paradigm.first, id)).second;
         if (insert_check) {
             auto metric        = FIND(MapCubeMetrics, 1)->second;
-            MapCubeMetrics[id] = cube_out.def_met(paradigm.second.name, paradigm.second.name, "DOUBLE", "sec", "", "",
+            MapCubeMetrics[id] = cube_out->def_met(paradigm.second.name, paradigm.second.name, "DOUBLE", "sec", "", "",
                                                   "", metric, cube::CUBE_METRIC_EXCLUSIVE);
         }
     }
@@ -129,52 +207,54 @@ bool CreateCube(AllData& alldata) {
                     aType = "INT64";
                 }
 
+                const auto& strings = alldata.definitions.strings;
+                string      name    = strings[metric.second.name];
+
                 auto c_met_ref =
                     metricToCubeMetric.insert(make_pair(metric.first, MapCubeMetrics.size())).first->second;
                 MapCubeMetrics[c_met_ref] =
-                    cube_out.def_met(metric.second.name, metric.second.name, aType, metric.second.unit, "", "",
-                                     metric.second.description, NULL, cube::CUBE_METRIC_EXCLUSIVE);
+                    cube_out->def_met(name, name, aType, strings[metric.second.unit], "", "",
+                                     strings[metric.second.description], NULL, cube::CUBE_METRIC_EXCLUSIVE);
             }
         }
     }
     // cube-metrics end!
 
     // create all the regions
-    for (auto& region : alldata.definitions.regions.get_all()) {
-        MapCubeRegions[region.first] =
-            cube_out.def_region(region.second.name, region.second.name, "", "", region.second.source_line, 0, "", "",
-                                region.second.file_name);
+    for (const auto& region : alldata.definitions.regions.get_all()) {
+        string name = alldata.definitions.strings[region.second.name];
+
+        MapCubeRegions[region.first] = cube_out->def_region(name, name, "", "", region.second.source_line, 0, "", "",
+                                                           alldata.definitions.strings[region.second.file_name]);
     }
     // stop it!
 
-    // create call path nodes -- trricky
-    for (auto it = alldata.call_path_tree.begin(); it != alldata.call_path_tree.end(); ++it) {
-        if (it->parent != nullptr) {
-            MapCubeCnodes[it.get()] = cube_out.def_cnode(MapCubeRegions.find(it->function_id)->second, "", 0,
-                                                         MapCubeCnodes.find(it->parent)->second);
+    // create call path nodes -- pre-order -> the cnode of the parent exists already
+    for (size_t i = 0; i < traversal.size(); ++i) {
+        auto* it     = traversal[i].node;
+        auto  parent = traversal[i].parent;
 
-        } else {
-            MapCubeCnodes[it.get()] = cube_out.def_cnode(FIND(MapCubeRegions, it->function_id)->second, "", 0, NULL);
-        }
+        cnodes[i].cnode = cube_out->def_cnode(FIND(MapCubeRegions, it->function_id)->second, "", 0,
+                                             parent != data_tree::npos ? cnodes[parent].cnode : NULL);
 
         if (!have_p2p) {
             if (it->has_p2p == true) {
                 p2p_start = MapCubeMetrics.size();
 
                 MapCubeMetrics[MapCubeMetrics.size()] =
-                    cube_out.def_met("P2P Communication sent", "met_p2psendcomm", "UINT64", "occ", "", "", "", NULL,
+                    cube_out->def_met("P2P Communication sent", "met_p2psendcomm", "UINT64", "occ", "", "", "", NULL,
                                      cube::CUBE_METRIC_EXCLUSIVE);
 
                 MapCubeMetrics[MapCubeMetrics.size()] =
-                    cube_out.def_met("P2P Communication received", "met_p2precvcomm", "UINT64", "occ", "", "", "", NULL,
+                    cube_out->def_met("P2P Communication received", "met_p2precvcomm", "UINT64", "occ", "", "", "", NULL,
                                      cube::CUBE_METRIC_EXCLUSIVE);
 
                 MapCubeMetrics[MapCubeMetrics.size()] =
-                    cube_out.def_met("P2P Bytes sent", "met_p2pbytessend", "UINT64", "Bytes", "", "", "", NULL,
+                    cube_out->def_met("P2P Bytes sent", "met_p2pbytessend", "UINT64", "Bytes", "", "", "", NULL,
                                      cube::CUBE_METRIC_EXCLUSIVE);
 
                 MapCubeMetrics[MapCubeMetrics.size()] =
-                    cube_out.def_met("P2P Bytes received", "met_p2pbytesrecv", "UINT64", "Bytes", "", "", "", NULL,
+                    cube_out->def_met("P2P Bytes received", "met_p2pbytesrecv", "UINT64", "Bytes", "", "", "", NULL,
                                      cube::CUBE_METRIC_EXCLUSIVE);
 
                 have_p2p = true;
@@ -186,22 +266,22 @@ bool CreateCube(AllData& alldata) {
                 collop_start = MapCubeMetrics.size();
 
                 MapCubeMetrics[MapCubeMetrics.size()] =
-                    cube_out.def_met("Collective Communication Bytes sent", "met_collopbytesout", "UINT64", "Bytes", "",
+                    cube_out->def_met("Collective Communication Bytes sent", "met_collopbytesout", "UINT64", "Bytes", "",
                                      "", "", NULL, cube::CUBE_METRIC_EXCLUSIVE);
 
                 MapCubeMetrics[MapCubeMetrics.size()] =
-                    cube_out.def_met("Collective Communication Bytes received", "met_collopbytesin", "UINT64", "Bytes",
+                    cube_out->def_met("Collective Communication Bytes received", "met_collopbytesin", "UINT64", "Bytes",
                                      "", "", "", NULL, cube::CUBE_METRIC_EXCLUSIVE);
 
                 MapCubeMetrics[MapCubeMetrics.size()] =
-                    cube_out.def_met("Collective Communication", "met_collopcomm_sum", "UINT64", "occ", "", "", "",
+                    cube_out->def_met("Collective Communication", "met_collopcomm_sum", "UINT64", "occ", "", "", "",
                                      NULL, cube::CUBE_METRIC_EXCLUSIVE);
 
-                MapCubeMetrics[MapCubeMetrics.size()] = cube_out.def_met(
+                MapCubeMetrics[MapCubeMetrics.size()] = cube_out->def_met(
                     "Collective Communication sent (occ)", "met_collopcomm_send", "UINT64", "occ", "", "", "",
                     FIND(MapCubeMetrics, collop_start + 2)->second, cube::CUBE_METRIC_EXCLUSIVE);
 
-                MapCubeMetrics[MapCubeMetrics.size()] = cube_out.def_met(
+                MapCubeMetrics[MapCubeMetrics.size()] = cube_out->def_met(
                     "Collective Communication received (occ)", "met_collopcomm_recv", "UINT64", "occ", "", "", "",
                     FIND(MapCubeMetrics, collop_start + 2)->second, cube::CUBE_METRIC_EXCLUSIVE);
 
@@ -212,7 +292,7 @@ bool CreateCube(AllData& alldata) {
 
 // since 4.4, initialize() needed
 #ifdef Cubelib_REVISION_NUMBER
-    cube_out.initialize();
+    cube_out->initialize();
 #endif
 
 // until version 4.4
@@ -222,120 +302,207 @@ bool CreateCube(AllData& alldata) {
     // initialize ist needed since rev 14755 (4.3.4)
     // needs to be initialised before nodes/metrics are filled with data -> else "Something is wrong
     // with ..." failure
-    cube_out.initialize();
+    cube_out->initialize();
 #endif
 #endif
 
-    // fill metrics!
-    for (auto it = alldata.call_path_tree.begin(); it != alldata.call_path_tree.end(); ++it) {
-        cube::Cnode*  tmp_cnode;
-        cube::Thread* tmp_thread;
-
-        string met_string;
-        auto*  region = alldata.definitions.regions.get(it->function_id);
-        if (region == nullptr) {
-            std::cerr << "funtion id " << it->function_id << " not found (" << __FILE__ << ":" << __LINE__ << ")";
-            continue;
-        }
-        uint64_t para_id = region->paradigm_id;
-        uint64_t id      = 0;
-        tmp_cnode        = MapCubeCnodes.find(it.get())->second;
-
-        for (const auto& it_data : it->node_data) {
-            auto* location = alldata.definitions.system_tree.location(it_data.first);
-            if (location == nullptr) {
-                cerr << "Cube Output: system location not found: " << it_data.first << endl;
-                continue;
-            }
-            tmp_thread = MapCubeThreads.find(location)->second;
+    // resolve all handles once -> the fill loop only indexes arrays
+    cube::Metric* visits_metric = FIND(MapCubeMetrics, 0)->second;
+    cube::Metric* time_metric   = FIND(MapCubeMetrics, 1)->second;
+
+    cube::Metric* p2p_metrics[4]    = {};
+    cube::Metric* collop_metrics[5] = {};
+    for (int i = 0; have_p2p && i < 4; ++i)
+        p2p_metrics[i] = FIND(MapCubeMetrics, p2p_start + i)->second;
+    for (int i = 0; have_collop && i < 5; ++i)
+        collop_metrics[i] = FIND(MapCubeMetrics, collop_start + i)->second;
+
+    // indexed by metric id, nullptr for metrics without cube metric
+    vector<cube::Metric*> metric_handles;
+    for (const auto& metric : metricToCubeMetric) {
+        if (metric.first >= metric_handles.size())
+            metric_handles.resize(metric.first + 1, nullptr);
+        metric_handles[metric.first] = FIND(MapCubeMetrics, metric.second)->second;
+    }
 
-            // function data
-            auto metric = FIND(MapCubeMetrics, 0)->second;
-            cube_out.set_sev(metric, tmp_cnode, tmp_thread, it_data.second.f_data.count);
+    for (size_t i = 0; i < traversal.size(); ++i) {
+        auto* region = alldata.definitions.regions.get(traversal[i].node->function_id);
+        if (region == nullptr)
+            continue;
 
-            id = FIND(paradigmToCubeMetric_occ, para_id)->second;
+        cnodes[i].occ  = FIND(MapCubeMetrics, FIND(paradigmToCubeMetric_occ, region->paradigm_id)->second)->second;
+        cnodes[i].time = FIND(MapCubeMetrics, FIND(paradigmToCubeMetric_time, region->paradigm_id)->second)->second;
+    }
 
-            metric = FIND(MapCubeMetrics, id)->second;
-            cube_out.set_sev(metric, tmp_cnode, tmp_thread, it_data.second.f_data.count);
+    // indexed by the location index of the tree, locations of an aggregated node share its thread
+    auto locations = alldata.call_path_tree.locations();
+    if (locations == nullptr)
+        locations = make_shared<LocationIndex>(alldata.definitions.system_tree.location_ids());
 
-            metric = FIND(MapCubeMetrics, 0)->second;
-            cube_out.set_sev(metric, tmp_cnode, tmp_thread,
-                             (double)it_data.second.f_data.excl_time / (double)alldata.metaData.timerResolution);
+    vector<cube::Thread*> threads(locations->size(), nullptr);
+    for (uint32_t i = 0; i < locations->size(); ++i) {
+        auto* location = system_tree->location(locations->location(i));
+        if (location != nullptr)
+            threads[i] = MapCubeThreads[location];
+    }
 
-            id = FIND(paradigmToCubeMetric_time, para_id)->second;
+    double timer_resolution = (double)alldata.metaData.timerResolution;
 
-            metric = FIND(MapCubeMetrics, id)->second;
-            cube_out.set_sev(metric, tmp_cnode, tmp_thread,
-                             (double)it_data.second.f_data.excl_time / (double)alldata.metaData.timerResolution);
+    // stages the severities of the nodes [first, last) -> no cube calls, runs in a worker thread
+    auto stage = [&](size_t first, size_t last) {
+        SeverityBlock block;
 
-            // message data
-            if (it_data.second.m_data.count_send > 0) {
-                metric = FIND(MapCubeMetrics, p2p_start)->second;
-                cube_out.set_sev(metric, tmp_cnode, tmp_thread, it_data.second.m_data.count_send);
+        // aggregated threads -> one severity per <metric, thread> of a node, position in block.severities
+        map<pair<cube::Metric*, cube::Thread*>, size_t> merged;
 
-                metric = FIND(MapCubeMetrics, p2p_start + 2)->second;
-                cube_out.set_sev(metric, tmp_cnode, tmp_thread, it_data.second.m_data.bytes_send);
+        auto add = [&](cube::Metric* metric, cube::Thread* thread, MetricDataType type, MetricData::Data value) {
+            if (aggregate) {
+                auto res = merged.insert(make_pair(make_pair(metric, thread), block.severities.size()));
+                if (!res.second) {
+                    auto& sum = block.severities[res.first->second].value;
+                    switch (type) {
+                        case MetricDataType::UINT64:
+                            sum.u += value.u;
+                            break;
+                        case MetricDataType::INT64:
+                            sum.s += value.s;
+                            break;
+                        case MetricDataType::DOUBLE:
+                            sum.d += value.d;
+                            break;
+                    }
+                    return;
+                }
             }
 
-            if (it_data.second.m_data.count_recv > 0) {
-                metric = FIND(MapCubeMetrics, p2p_start + 1)->second;
-                cube_out.set_sev(metric, tmp_cnode, tmp_thread, it_data.second.m_data.count_recv);
+            block.severities.push_back({metric, thread, type, value});
+        };
 
-                metric = FIND(MapCubeMetrics, p2p_start + 3)->second;
-                cube_out.set_sev(metric, tmp_cnode, tmp_thread, it_data.second.m_data.bytes_recv);
+        for (size_t i = first; i < last; ++i) {
+            auto* it = traversal[i].node;
+
+            if (cnodes[i].occ == nullptr) {
+                std::cerr << "funtion id " << it->function_id << " not found (" << __FILE__ << ":" << __LINE__ << ")";
+                continue;
             }
 
-            // collop
-            uint64_t sum = 0;
+            for (const auto& it_data : it->node_data) {
+                auto          index      = locations->index(it_data.first);
+                cube::Thread* tmp_thread = index != LocationIndex::npos ? threads[index] : nullptr;
+                if (tmp_thread == nullptr) {
+                    cerr << "Cube Output: system location not found: " << it_data.first << endl;
+                    continue;
+                }
 
-            if (it_data.second.c_data.count_send > 0) {
-                metric = FIND(MapCubeMetrics, collop_start + 3)->second;
-                cube_out.set_sev(metric, tmp_cnode, tmp_thread, it_data.second.c_data.count_send);
+                const auto& f = it_data.second.f_data;
+                const auto& m = it_data.second.m_data;
+                const auto& c = it_data.second.c_data;
 
-                sum += it_data.second.c_data.count_send;
+                // function data
+                add(visits_metric, tmp_thread, MetricDataType::UINT64, f.count);
+                add(cnodes[i].occ, tmp_thread, MetricDataType::UINT64, f.count);
 
-                metric = FIND(MapCubeMetrics, collop_start)->second;
-                cube_out.set_sev(FIND(MapCubeMetrics, collop_start)->second, tmp_cnode, tmp_thread,
-                                 it_data.second.c_data.bytes_send);
-            }
+                double excl_time = (double)f.excl_time / timer_resolution;
+                add(time_metric, tmp_thread, MetricDataType::DOUBLE, excl_time);
+                add(cnodes[i].time, tmp_thread, MetricDataType::DOUBLE, excl_time);
 
-            if (it_data.second.c_data.count_recv > 0) {
-                metric = FIND(MapCubeMetrics, collop_start + 4)->second;
-                cube_out.set_sev(metric, tmp_cnode, tmp_thread, it_data.second.c_data.count_recv);
+                // message data
+                if (m.count_send > 0) {
+                    add(p2p_metrics[0], tmp_thread, MetricDataType::UINT64, m.count_send);
+                    add(p2p_metrics[2], tmp_thread, MetricDataType::UINT64, m.bytes_send);
+                }
 
-                sum += it_data.second.c_data.count_recv;
+                if (m.count_recv > 0) {
+                    add(p2p_metrics[1], tmp_thread, MetricDataType::UINT64, m.count_recv);
+                    add(p2p_metrics[3], tmp_thread, MetricDataType::UINT64, m.bytes_recv);
+                }
 
-                metric = FIND(MapCubeMetrics, collop_start + 1)->second;
-                cube_out.set_sev(metric, tmp_cnode, tmp_thread, it_data.second.c_data.bytes_recv);
-            }
+                // collop
+                if (c.count_send > 0) {
+                    add(collop_metrics[3], tmp_thread, MetricDataType::UINT64, c.count_send);
+                    add(collop_metrics[0], tmp_thread, MetricDataType::UINT64, c.bytes_send);
+                }
 
-            if (sum > 0) {
-                metric = FIND(MapCubeMetrics, collop_start + 2)->second;
-                cube_out.set_sev(metric, tmp_cnode, tmp_thread, sum);
-            }
+                if (c.count_recv > 0) {
+                    add(collop_metrics[4], tmp_thread, MetricDataType::UINT64, c.count_recv);
+                    add(collop_metrics[1], tmp_thread, MetricDataType::UINT64, c.bytes_recv);
+                }
+
+                uint64_t sum = c.count_send + c.count_recv;
+                if (sum > 0)
+                    add(collop_metrics[2], tmp_thread, MetricDataType::UINT64, sum);
 
-            if (!it_data.second.metrics.empty()) {
                 for (auto it_met : it_data.second.metrics) {
                     auto& metric      = it_met.second;
-                    auto* cube_metric = FIND(MapCubeMetrics, FIND(metricToCubeMetric, it_met.first)->second)->second;
-                    switch (metric.type) {
-                        case MetricDataType::UINT64:
-                            cube_out.set_sev(cube_metric, tmp_cnode, tmp_thread, (uint64_t)metric.data_excl);
-                            break;
-                        case MetricDataType::INT64:
-                            cube_out.set_sev(cube_metric, tmp_cnode, tmp_thread, (int64_t)metric.data_excl);
-                            break;
-                        case MetricDataType::DOUBLE:
-                            cube_out.set_sev(cube_metric, tmp_cnode, tmp_thread, (double)metric.data_excl);
-                            break;
+                    auto* cube_metric = it_met.first < metric_handles.size() ? metric_handles[it_met.first] : nullptr;
+                    if (cube_metric == nullptr) {
+                        std::cerr << __FILE__ << ":" << __LINE__ << ": error: while creating cube output" << endl;
+                        exit(1);
                     }
+
+                    add(cube_metric, tmp_thread, metric.type, metric.data_excl);
+                }
+            }
+
+            block.nodes.push_back(make_pair(i, block.severities.size()));
+            merged.clear();
+        }
+
+        return block;
+    };
+
+    // blocks of about block_rows rows, staged by up to num_threads threads while the main thread sets the
+    // severities of the finished blocks in order (set_sev is not thread-safe) -> at most num_threads + 1 blocks exist
+    vector<pair<size_t, size_t>> blocks;
+    size_t                       rows  = 0;
+    size_t                       first = 0;
+    for (size_t i = 0; i < traversal.size(); ++i) {
+        rows += traversal[i].node->node_data.size();
+
+        if (rows >= block_rows || i + 1 == traversal.size()) {
+            blocks.push_back(make_pair(first, i + 1));
+            first = i + 1;
+            rows  = 0;
+        }
+    }
+
+    size_t                        workers = max<uint32_t>(1, alldata.params.num_threads);
+    size_t                        next    = 0;
+    std::deque<std::future<SeverityBlock>> pending;
+
+    // fill metrics!
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        for (; next < blocks.size() && pending.size() < workers; ++next)
+            pending.push_back(std::async(std::launch::async, stage, blocks[next].first, blocks[next].second));
+
+        auto block = pending.front().get();
+        pending.pop_front();
+
+        size_t begin = 0;
+        for (const auto& node : block.nodes) {
+            auto* tmp_cnode = cnodes[node.first].cnode;
+
+            for (size_t i = begin; i < node.second; ++i) {
+                const auto& sev = block.severities[i];
+
+                switch (sev.type) {
+                    case MetricDataType::UINT64:
+                        cube_out->set_sev(sev.metric, tmp_cnode, sev.thread, sev.value.u);
+                        break;
+                    case MetricDataType::INT64:
+                        cube_out->set_sev(sev.metric, tmp_cnode, sev.thread, sev.value.s);
+                        break;
+                    case MetricDataType::DOUBLE:
+                        cube_out->set_sev(sev.metric, tmp_cnode, sev.thread, sev.value.d);
+                        break;
                 }
             }
+
+            begin = node.second;
         }
     }
 
-    string   fname = alldata.params.output_file_prefix;
-    ofstream out;
+    string fname = alldata.params.output_file_prefix;
     /* TODO no_reduce fixen/implementieren
         if( alldata.metaData.params.no_reduce ) {
 
@@ -346,7 +513,10 @@ bool CreateCube(AllData& alldata) {
 
         }
     */
-    cube_out.writeCubeReport(fname);
 
-    return true;
+    // the cube does not depend on alldata any more -> written while the other outputs are created
+    return std::async(std::launch::async, [cube_out, fname]() {
+        cube_out->writeCubeReport(fname);
+        return true;
+    });
 }
@@ -2,14 +2,11 @@
  This is part of the OTF-Profiler. Copyright by ZIH, TU Dresden 2016-2018.
  Authors: Maximillian Neumann, Denis Hünich, Jens Doleschal, Bill Williams
 */
-#include <fstream>
 #include <iostream>
 #include <string>
 #include "all_data.h"
+#include "json_file.h"
 #include "rapidjson/document.h"
-#include "rapidjson/prettywriter.h"
-#include "rapidjson/stringbuffer.h"
-#include "rapidjson/writer.h"
 
 using namespace rapidjson;
 using std::cout;
@@ -63,7 +60,7 @@ struct FileInfo {
         const IoHandle* parent = defs.iohandles.get(self->parent);
         if (parent)
             parentfile = new FileInfo(defs, self->parent);
-        filename = self->name;
+        filename = defs.strings[self->name];
         paradigm.insert(defs.io_paradigms.get(self->io_paradigm)->name);
         modes = self->modes;
     }
@@ -197,11 +194,19 @@ void WorkflowProfile::WriteProfile(Writer& w) const {
     w.EndObject();
 }
 
+// the profile, written by WriteJSONFile
+struct ProfileDocument {
+    const WorkflowProfile& profile;
+
+    template <typename Writer>
+    void operator()(Writer& w) {
+        profile.WriteProfile(w);
+    }
+};
+
 bool CreateJSON(AllData& alldata) {
     cout << "Creating JSON profile" << std::endl;
-    WorkflowProfile            profile;
-    StringBuffer               b;
-    PrettyWriter<StringBuffer> w(b);
+    WorkflowProfile profile;
     for (const auto& n : alldata.definitions.system_tree) {
         switch (n.data.class_id) {
             case definitions::SystemClass::LOCATION:
@@ -235,40 +240,43 @@ bool CreateJSON(AllData& alldata) {
         }
 
         profile.num_functions++;
-        uint64_t excl_time = 0;
 
-        for (const auto& one_node_data : call_node.node_data) {
-            profile.num_invocations += one_node_data.second.f_data.count;
-            auto& entries_map = profile.functions_by_paradigm[paradigm].entries;
-            entries_map[countstr] += one_node_data.second.f_data.count;
-            if (excl_time < one_node_data.second.f_data.excl_time) {
-                excl_time = one_node_data.second.f_data.excl_time;
-            }
-            auto&       message_entry = profile.messages_by_paradigm[paradigm];
-            auto&       collop_entry  = profile.collops_by_paradigm[paradigm];
-            const auto& message_data  = one_node_data.second.m_data;
-            const auto& collop_data   = one_node_data.second.c_data;
-            message_entry.add_data(bytestr, message_data.bytes_send);
-            message_entry.add_data(bytestr, message_data.bytes_recv);
-            message_entry.add_data(countstr, message_data.count_send);
-            message_entry.add_data(countstr, message_data.count_recv);
-            if (one_node_data.second.c_data.bytes_send)
-                profile.collops_by_paradigm[paradigm].entries[bytestr] += one_node_data.second.c_data.bytes_send;
-            if (one_node_data.second.c_data.bytes_recv)
-                profile.collops_by_paradigm[paradigm].entries[bytestr] += one_node_data.second.c_data.bytes_recv;
-            if (one_node_data.second.c_data.count_send)
-                profile.collops_by_paradigm[paradigm].entries[countstr] += one_node_data.second.c_data.count_send;
-            if (one_node_data.second.c_data.count_recv)
-                profile.collops_by_paradigm[paradigm].entries[countstr] += one_node_data.second.c_data.count_recv;
-            for (const auto& metric : one_node_data.second.metrics) {
-                if (metric.second.type == MetricDataType::UINT64) {
-                    auto m = alldata.definitions.metrics.get(metric.first);
-                    if (m)
-                        profile.counters[m->name] += (uint64_t)metric.second.data_excl;
-                }
+        // statistics over all locations of the node
+        const auto& summary   = *alldata.summary;
+        auto        path      = call_node.index;
+        auto        sum       = [&](TreeSummary::Field f) { return summary.field(path, f).sum; };
+        auto        excl      = summary.field(path, TreeSummary::EXCL_TIME);
+        uint64_t    excl_time = excl.present() ? excl.max : 0;
+
+        if (summary.locations(path) > 0) {
+            profile.num_invocations += sum(TreeSummary::COUNT);
+            profile.functions_by_paradigm[paradigm].entries[countstr] += sum(TreeSummary::COUNT);
+
+            auto& message_entry = profile.messages_by_paradigm[paradigm];
+            auto& collop_entry  = profile.collops_by_paradigm[paradigm];
+            message_entry.add_data(bytestr, sum(TreeSummary::MSG_BYTES_SEND));
+            message_entry.add_data(bytestr, sum(TreeSummary::MSG_BYTES_RECV));
+            message_entry.add_data(countstr, sum(TreeSummary::MSG_COUNT_SEND));
+            message_entry.add_data(countstr, sum(TreeSummary::MSG_COUNT_RECV));
+            if (sum(TreeSummary::COLLOP_BYTES_SEND))
+                collop_entry.entries[bytestr] += sum(TreeSummary::COLLOP_BYTES_SEND);
+            if (sum(TreeSummary::COLLOP_BYTES_RECV))
+                collop_entry.entries[bytestr] += sum(TreeSummary::COLLOP_BYTES_RECV);
+            if (sum(TreeSummary::COLLOP_COUNT_SEND))
+                collop_entry.entries[countstr] += sum(TreeSummary::COLLOP_COUNT_SEND);
+            if (sum(TreeSummary::COLLOP_COUNT_RECV))
+                collop_entry.entries[countstr] += sum(TreeSummary::COLLOP_COUNT_RECV);
+            for (const auto& metric : summary.metrics()) {
+                if (!metric.integer || !summary.integer(path, metric.incl + 1).present())
+                    continue;
+
+                auto m = alldata.definitions.metrics.get(metric.metric_id);
+                if (m)
+                    profile.counters[alldata.definitions.strings[m->name]] +=
+                        summary.integer(path, metric.incl + 1).sum;
             }
         }
-        if (call_node.node_data.size() == 1) {
+        if (summary.locations(path) == 1) {
             profile.serial_time += excl_time;
         } else {
             profile.parallel_region_time += excl_time;
@@ -286,14 +294,12 @@ bool CreateJSON(AllData& alldata) {
         profile.io_ops_by_paradigm[paradigm_name].entries[meta_time] += io_entry.second.nontransfer_time;
     }
     for (auto file_entry : alldata.definitions.iohandles.get_all()) {
-        auto file_handle = file_entry.second;
-        profile.file_data[file_handle.name] += FileInfo(alldata.definitions, file_entry.first);
+        const auto& file_handle = file_entry.second;
+        profile.file_data[alldata.definitions.strings[file_handle.name]] += FileInfo(alldata.definitions, file_entry.first);
     }
     profile.filename = alldata.params.input_file_name;
     profile.traceID  = alldata.traceID;
-    profile.WriteProfile(w);
-    string        fname = alldata.params.output_file_prefix + ".json";
-    std::ofstream outfile(fname.c_str());
-    outfile << b.GetString() << std::endl;
-    return true;
+
+    ProfileDocument document{profile};
+    return WriteJSONFile(alldata.params.output_file_prefix + ".json", alldata.params.pretty_json, document);
 }
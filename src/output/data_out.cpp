@@ -1,15 +1,22 @@
-#include <fstream>
 #include <iostream>
 #include <string>
 #include "all_data.h"
 #include "data_out.h"
 #include "rapidjson/document.h"
-#include "rapidjson/stringbuffer.h"
-#include "rapidjson/writer.h"
-#include "rapidjson/prettywriter.h"
+#include "json_file.h"
 #include "definitions.h"
 #include "main_structs.h"
 
+// the whole dump, written by WriteJSONFile
+struct DataDocument {
+    const AllData& alldata;
+
+    template <typename Writer>
+    void operator()(Writer& writer) {
+        display(writer, alldata);
+    }
+};
+
 bool DataOut(AllData& alldata){
 
 
@@ -19,19 +26,12 @@ bool DataOut(AllData& alldata){
     // (vlevel, bool master_only, msg)
     alldata.verbosePrint(1, true, "producing json output");
 
-    rapidjson::StringBuffer buffer;
-    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
-    display(writer, alldata);
-    std::string fname = alldata.params.output_file_prefix + ".json";
-    std::ofstream outfile(fname);
-    outfile << buffer.GetString() << std::endl;
-    //std::cout << buffer.GetString() << std::endl;
-
-    return true;
+    DataDocument document{alldata};
+    return WriteJSONFile(alldata.params.output_file_prefix + ".json", alldata.params.pretty_json, document);
 }
 
 template <typename Writer>
-void display(Writer& writer, AllData alldata){
+void display(Writer& writer, const AllData& alldata){
     writer.StartObject();
         display_meta_data(alldata, writer);
         display_meta_data_profiler(alldata, writer);
@@ -43,7 +43,7 @@ void display(Writer& writer, AllData alldata){
 }
 
 template <typename Writer>
-void display_data_tree(AllData alldata, Writer& writer){
+void display_data_tree(const AllData& alldata, Writer& writer){
     writer.String("call_tree");
     writer.StartObject();
         writer.Key("root_nodes");
@@ -56,7 +56,7 @@ void display_data_tree(AllData alldata, Writer& writer){
 }
 
 template <typename Writer>
-void display_node(std::shared_ptr<tree_node> node, Writer& writer){
+void display_node(const tree_node* node, Writer& writer){
     writer.StartObject();
         writer.Key("region_id");
         writer.Uint64(node->function_id);
@@ -155,7 +155,7 @@ void display_node(std::shared_ptr<tree_node> node, Writer& writer){
 }
 
 template <typename Writer>
-void display_definitions(AllData alldata, Writer& writer){
+void display_definitions(const AllData& alldata, Writer& writer){
     writer.Key("Definitions");
     writer.StartObject();
         writer.Key("paradigms");
@@ -175,13 +175,13 @@ void display_definitions(AllData alldata, Writer& writer){
                     writer.Key("region_id");
                     writer.Uint(region.first);
                     writer.Key("name");
-                    writer.String(region.second.name.c_str());
+                    writer.String(alldata.definitions.strings[region.second.name]);
                     writer.Key("paradigm_id");
                     writer.Uint(region.second.paradigm_id);
                     writer.Key("source_line");
                     writer.Uint(region.second.source_line);
                     writer.Key("file_name");
-                    writer.String(region.second.file_name.c_str());
+                    writer.String(alldata.definitions.strings[region.second.file_name]);
                 writer.EndObject();
             }
         writer.EndArray();
@@ -194,9 +194,9 @@ void display_definitions(AllData alldata, Writer& writer){
                         writer.Key("metric_id");
                         writer.Uint64(it.first);
                         writer.Key("name");
-                        writer.String(metric.name.c_str());
+                        writer.String(alldata.definitions.strings[metric.name]);
                         writer.Key("description");
-                        writer.String(metric.description.c_str());
+                        writer.String(alldata.definitions.strings[metric.description]);
                         writer.Key("metricType");
                         writer.Uint(static_cast<uint> (metric.metricType));
                         writer.Key("metricMode");
@@ -208,7 +208,7 @@ void display_definitions(AllData alldata, Writer& writer){
                         writer.Key("exponent");
                         writer.Int64(metric.exponent);
                         writer.Key("unit");
-                        writer.String(metric.unit.c_str());
+                        writer.String(alldata.definitions.strings[metric.unit]);
                         writer.Key("allowed");
                         writer.Bool(metric.allowed);
                 writer.EndObject();
@@ -259,7 +259,7 @@ void display_definitions(AllData alldata, Writer& writer){
                     writer.Key(std::to_string(iohandle.first).c_str());
                     writer.StartObject();
                         writer.Key("name");
-                        writer.String(iohandle.second.name.c_str());
+                        writer.String(alldata.definitions.strings[iohandle.second.name]);
                         writer.Key("io_paradigm");
                         writer.Uint(iohandle.second.io_paradigm);
                         writer.Key("file");
@@ -298,7 +298,7 @@ void display_definitions(AllData alldata, Writer& writer){
 }
 
 template <typename Writer>
-void display_meta_data(AllData alldata, Writer& writer){
+void display_meta_data(const AllData& alldata, Writer& writer){
     writer.Key("meta_data");
     writer.StartObject();
         writer.Key("timerResolution");
@@ -314,7 +314,7 @@ void display_meta_data(AllData alldata, Writer& writer){
 }
 
 template <typename Writer>
-void display_meta_data_profiler(AllData alldata, Writer& writer){
+void display_meta_data_profiler(const AllData& alldata, Writer& writer){
     writer.Key("meta_data_profiler");
     writer.StartObject();
     writer.Key("communicators");
@@ -368,18 +368,11 @@ void display_meta_data_profiler(AllData alldata, Writer& writer){
         writer.Key("myRank");
         writer.Uint64(alldata.metaData.myRank);
 
-        #ifdef OTFPROFILER_MPI
-            writer.Key("packBufferSize");
-            writer.Uint64(alldata.metaData.packBufferSize);
-            writer.Key("packBuffer");
-            writer.String(alldata.metaData.packBuffer);
-        #endif
-    
     writer.EndObject();
 }
 
 template <typename Writer>
-void display_params(AllData alldata, Writer& writer){
+void display_params(const AllData& alldata, Writer& writer){
     writer.Key("Params");
     writer.StartObject();
         writer.Key("max_file_handles");
@@ -410,7 +403,7 @@ void display_params(AllData alldata, Writer& writer){
 }
 
 template <typename Writer>
-void display_system_tree(AllData alldata, Writer& writer){
+void display_system_tree(const AllData& alldata, Writer& writer){
     writer.Key("system_tree");
     writer.StartObject();
         writer.Key("system_nodes");
@@ -429,7 +422,7 @@ void display_system_tree(AllData alldata, Writer& writer){
 }
 
 template <typename Writer>
-void display_system_node(std::shared_ptr<definitions::SystemTree::SystemNode> node, AllData alldata, Writer& writer){
+void display_system_node(const std::shared_ptr<definitions::SystemTree::SystemNode>& node, const AllData& alldata, Writer& writer){
     writer.StartObject();
         writer.Key("parent");
         if(node->parent == nullptr)
@@ -3,7 +3,9 @@
 
 void Dot_writer::read_data(AllData& alldata) {
 
-    std::stack<Node*> parent_nodes;
+    // call ids are the positions in the pre-order index -> parents are found by index
+    alldata.call_path_tree.freeze();
+    const auto& traversal = alldata.call_path_tree.traversal();
 
     int call_id = 0;
 
@@ -14,7 +16,7 @@ void Dot_writer::read_data(AllData& alldata) {
         node->call_id = call_id;
         ++call_id;
 
-        std::string region_name = alldata.definitions.regions.get(region.function_id)->name;
+        std::string region_name = alldata.definitions.strings[alldata.definitions.regions.get(region.function_id)->name];
         node->region = region_name;
 
         node->num_children = region.children.size();
@@ -22,10 +24,28 @@ void Dot_writer::read_data(AllData& alldata) {
         // mpi time resolution
         double timerResolution = (double)alldata.metaData.timerResolution;
 
-        // accumulate data over all locations
-        for (const auto& location : region.node_data) {
-            // filter per rank
-            if(alldata.params.rank == -1 || alldata.params.rank == location.first){
+        // statistics over all locations
+        if (alldata.params.rank == -1) {
+            const auto& summary = *alldata.summary;
+
+            auto incl = summary.field(region.index, TreeSummary::INCL_TIME);
+            auto excl = summary.field(region.index, TreeSummary::EXCL_TIME);
+
+            node->invocations = summary.field(region.index, TreeSummary::COUNT).sum;
+
+            if (incl.present()) {
+                node->min_incl_time = incl.min / timerResolution;
+                node->max_incl_time = incl.max / timerResolution;
+                node->min_excl_time = excl.min / timerResolution;
+                node->max_excl_time = excl.max / timerResolution;
+            }
+            node->sum_incl_time = incl.sum / timerResolution;
+            node->sum_excl_time = excl.sum / timerResolution;
+        } else {
+            // accumulate data over the locations of the selected rank
+            for (const auto& location : region.node_data) {
+                if(alldata.params.rank != location.first)
+                    continue;
 
                 node->invocations += location.second.f_data.count;
 
@@ -46,20 +66,20 @@ void Dot_writer::read_data(AllData& alldata) {
         }
 
         // average time
-        node->avg_incl_time = node->sum_incl_time / region.node_data.size();
-        node->avg_excl_time = node->sum_excl_time / region.node_data.size();
+        size_t num_locations = alldata.params.rank == -1 ? alldata.summary->locations(region.index)
+                                                          : region.node_data.size();
+        node->avg_incl_time = node->sum_incl_time / num_locations;
+        node->avg_excl_time = node->sum_excl_time / num_locations;
 
         // set parent <-> child relationship
-        if(parent_nodes.size() != 0){
+        auto parent = traversal[region.index].parent;
+        if(parent != data_tree::npos){
 
-            parent_nodes.top()->children.push_back(node);
+            nodes[parent]->children.push_back(node);
 
-            node->parent = parent_nodes.top();
-            parent_nodes.pop();
+            node->parent = nodes[parent];
         }
 
-        for( int i = 0; i < node->num_children; ++i )
-            parent_nodes.push(node);
         nodes.push_back(node);
 
         // accumulate total sum time of all nodes
@@ -1,11 +1,19 @@
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <set>
 #include <sstream>
+#include <thread>
 
 #include "OTF2Reader.h"
 #include "otf2/OTF2_Definitions.h"
 #include "otf2/OTF2_GeneralDefinitions.h"
+#include "otf2/OTF2_Pthread_Locks.h"
 
-#ifdef OTFPROFILE_MPI
+#ifdef OTFPROFILER_MPI
 #include <otf2/OTF2_MPI_Collectives.h>
 #endif
 
@@ -16,16 +24,6 @@
 
 using namespace std;
 
-/** OTF2 reader handle */
-// metric id (real), data
-static map<uint64_t, MetricData>        tmp_metric;
-static std::vector<uint64_t>            locationList;
-static StringIdentifier<OTF2_StringRef> string_id;
-static StringIdentifier<OTF2_IoFileRef> filesystem_entries;
-// TODO remove
-// static std::map<OTF2_StringRef, string> stringIdToString;
-static uint64_t              systemTreeNodeId;
-static std::deque<StackData> node_stack;
 
 string OTF2ParadigmToString(OTF2_Paradigm paradigm) {
     switch (paradigm) {
@@ -78,6 +76,9 @@ string OTF2ParadigmToString(OTF2_Paradigm paradigm) {
 
 MetricMode mappingOTF2MetricMode( OTF2_MetricMode metricMode ){
     switch (metricMode){
+        case OTF2_METRIC_ACCUMULATED_START:
+            return MetricMode::ACCUMULATED_START;
+
         case OTF2_METRIC_ACCUMULATED_POINT:
             return MetricMode::ACCUMULATED_POINT;
 
@@ -166,7 +167,14 @@ bool OTF2Reader::initialize(AllData& alldata) {
         cerr << "Failed to open OTF2-Reader" << endl;
         return false;
     }
-#ifdef OTFPROFILE_MPI
+
+    if (alldata.params.num_threads > 1) {
+        if (OTF2_SUCCESS != OTF2_Pthread_Reader_SetLockingCallbacks(_reader, nullptr)) {
+            cerr << "Failed to set locking callbacks of OTF2-Reader" << endl;
+            return false;
+        }
+    }
+#ifdef OTFPROFILER_MPI
     OTF2_MPI_Reader_SetCollectiveCallbacks(_reader, MPI_COMM_WORLD);
 #endif
 
@@ -178,7 +186,15 @@ bool OTF2Reader::initialize(AllData& alldata) {
              << "ranks " << alldata.metaData.numRanks << " to " << number_locations << endl;
     }
 
-    locationList.reserve(number_locations);
+    _region_filter = RegionFilter();
+    _filtered_regions.clear();
+    if (!alldata.params.filter_file.empty() && !_region_filter.load(alldata.params.filter_file))
+        return false;
+
+    _locations.clear();
+    _location_events.clear();
+    _locations.reserve(number_locations);
+    _location_events.reserve(number_locations);
 
     // convert and add all OTF2 Paradigms
     auto& paradigms = alldata.definitions.paradigms;
@@ -203,34 +219,51 @@ void OTF2Reader::close() {
 /*                                                                    */
 /* ****************************************************************** */
 
+// records a definition for --lazy-definitions, a redefinition keeps its ordinal
+template <typename T>
+static void add_pending(definitions::DefinitionType<uint64_t, PendingDefinition<T>>& pending, uint64_t id,
+                        const T& definition) {
+    auto* known = pending.get(id);
+    pending.add(id, {definition, known != nullptr ? known->ordinal : static_cast<uint32_t>(pending.size())});
+}
+
 OTF2_CallbackCode OTF2Reader::handle_def_io_handle(void* userData, OTF2_IoHandleRef self, OTF2_StringRef name,
                                                    OTF2_IoFileRef file, OTF2_IoParadigmRef ioParadigm,
                                                    OTF2_IoHandleFlag ioHandleFlags, OTF2_CommRef comm,
                                                    OTF2_IoHandleRef parent) {
-    auto* alldata = static_cast<AllData*>(userData);
+    auto* reader = static_cast<OTF2Reader*>(userData);
+    auto* alldata = reader->_alldata;
+
+    definitions::StringRef handle_name;
     if (file != OTF2_UNDEFINED_IO_FILE) {
-        auto strings = filesystem_entries.get(file);
-        if (strings.second != OTF2_CALLBACK_SUCCESS)
-            return strings.second;
-        alldata->definitions.iohandles.add(self,
-                                           {*strings.first[0], ioParadigm, file, parent, std::set<std::string>()});
-        return OTF2_CALLBACK_SUCCESS;
+        auto* entry = reader->_filesystem_entries.get(file);
+        if (entry == nullptr)
+            return OTF2_CALLBACK_INTERRUPT;
+        handle_name = *entry;
     } else {
-        auto strings = string_id.get(name);
+        auto strings = reader->_string_id.get(name);
         if (strings.second != OTF2_CALLBACK_SUCCESS)
             return strings.second;
-        alldata->definitions.iohandles.add(self,
-                                           {*strings.first[0], ioParadigm, file, parent, std::set<std::string>()});
+        handle_name = strings.first[0];
     }
+
+    definitions::IoHandle handle{handle_name, ioParadigm, file, parent, std::set<std::string>()};
+
+    if (reader->_lazy_definitions)
+        add_pending(reader->_pending_iohandles, self, handle);
+    else
+        alldata->definitions.iohandles.add(self, handle);
+
     return OTF2_CALLBACK_SUCCESS;
 }
 
 OTF2_CallbackCode OTF2Reader::handle_def_io_fs_entry(void* userData, OTF2_IoFileRef self, OTF2_StringRef name,
                                                      OTF2_SystemTreeNodeRef scope) {
-    auto strings = string_id.get(name);
+    auto* reader  = static_cast<OTF2Reader*>(userData);
+    auto  strings = reader->_string_id.get(name);
     if (strings.second != OTF2_CALLBACK_SUCCESS)
         return strings.second;
-    filesystem_entries.add(self, strings.first[0]->c_str());
+    reader->_filesystem_entries.add(self, strings.first[0]);
     return OTF2_CALLBACK_SUCCESS;
 }
 
@@ -241,7 +274,8 @@ OTF2_CallbackCode OTF2Reader::handle_def_io_fs_entry(void* userData, OTF2_IoFile
     OTF2_CallbackCode OTF2Reader::handle_def_clock_properties(void* userData, uint64_t timerResolution,
                                                               uint64_t globalOffset, uint64_t traceLength) {                                    //OTF2 2.x
 #endif
-    auto* alldata = static_cast<AllData*>(userData);
+    auto* reader = static_cast<OTF2Reader*>(userData);
+    auto* alldata = reader->_alldata;
 
     alldata->metaData.timerResolution = timerResolution;
 
@@ -268,8 +302,9 @@ OTF2_CallbackCode OTF2Reader::handle_def_metrics(   void*                   user
                                         OTF2_StringRef          unit
                                     ){
 
-    auto* alldata = static_cast<AllData*>(userData);
-    auto  strings = string_id.get(name, description, unit);
+    auto* reader = static_cast<OTF2Reader*>(userData);
+    auto* alldata = reader->_alldata;
+    auto  strings = reader->_string_id.get(name, description, unit);
 
     if (strings.second != OTF2_CALLBACK_SUCCESS)
         return strings.second;
@@ -295,15 +330,17 @@ OTF2_CallbackCode OTF2Reader::handle_def_metrics(   void*                   user
     //                                      {*strings.first[0], *strings.first[1], *strings.first[2], a_type, false});
     // }
 
+    auto& string_id = reader->_string_id;
+
     definitions::Metric metric{
-        *strings.first[0],                  // name
-        *strings.first[1],                  // description
-        mappingOTF2MetricType(metricType),  //PAPI, etc.
-        mappingOTF2MetricMode(metricMode),  //accumulative, relative, etc.
-        a_type,                             // type of the value: OTF2_TYPE_INT64, etc.
+        string_id.intern(strings.first[0]),  // name
+        string_id.intern(strings.first[1]),  // description
+        mappingOTF2MetricType(metricType),   //PAPI, etc.
+        mappingOTF2MetricMode(metricMode),   //accumulative, relative, etc.
+        a_type,                              // type of the value: OTF2_TYPE_INT64, etc.
         base == OTF2_BASE_BINARY ? MetricBase::BINARY : MetricBase::DECIMAL,
         exponent,
-        *strings.first[2],                  // unit
+        string_id.intern(strings.first[2]),  // unit
         false
     };
 
@@ -312,7 +349,7 @@ OTF2_CallbackCode OTF2Reader::handle_def_metrics(   void*                   user
     return OTF2_CALLBACK_SUCCESS;
 }
 
-// for metrics -> narrowing the metrics to synchronous
+// strict synchronous classes are accumulated per call path node, all others are attributed by their sample intervals
 OTF2_CallbackCode OTF2Reader::handle_def_metric_class(  void*                       userData,
                                                         OTF2_MetricRef              self,
                                                         uint8_t                     numberOfMetrics,
@@ -322,27 +359,25 @@ OTF2_CallbackCode OTF2Reader::handle_def_metric_class(  void*
 
 
 
-    auto* alldata = static_cast<AllData*>(userData);
+    auto* reader = static_cast<OTF2Reader*>(userData);
+    auto* alldata = reader->_alldata;
 
     if( recorderKind != OTF2_RECORDER_KIND_ABSTRACT) {
-        if(metricOccurrence == OTF2_METRIC_SYNCHRONOUS_STRICT){
-
-            definitions::Metric_Class metric_class {
-                numberOfMetrics,
-                std::map<uint8_t, uint32_t>(),
-                mappingOTF2MetricOccurrence(metricOccurrence),
-                mappingOTF2MetricRecorderType(recorderKind)
-            };
-
-            for (int i = 0; i < numberOfMetrics; ++i) {
-                auto* def_ref = alldata->definitions.metrics.get(metricMembers[i]);
-                if (def_ref != nullptr){
-                    metric_class.metric_member[i] = metricMembers[i];
-                        const_cast<definitions::Metric*>(def_ref)->allowed = true;
-                }
+        definitions::Metric_Class metric_class {
+            numberOfMetrics,
+            std::map<uint8_t, uint32_t>(),
+            mappingOTF2MetricOccurrence(metricOccurrence),
+            mappingOTF2MetricRecorderType(recorderKind)
+        };
+
+        for (int i = 0; i < numberOfMetrics; ++i) {
+            auto* def_ref = alldata->definitions.metrics.get(metricMembers[i]);
+            if (def_ref != nullptr){
+                metric_class.metric_member[i] = metricMembers[i];
+                    const_cast<definitions::Metric*>(def_ref)->allowed = true;
             }
-            alldata->definitions.metric_classes.add(self, metric_class);
         }
+        alldata->definitions.metric_classes.add(self, metric_class);
     }
 
 
@@ -358,14 +393,15 @@ OTF2_CallbackCode OTF2Reader::handle_def_metric_class(  void*
                                                             OTF2_StringRef name, OTF2_LocationGroupType locationGroupType,
                                                             OTF2_SystemTreeNodeRef systemTreeParent) {                                                  //OTF2 2.x
 #endif
-    auto* alldata = static_cast<AllData*>(userData);
+    auto* reader = static_cast<OTF2Reader*>(userData);
+    auto* alldata = reader->_alldata;
 
-    auto strings = string_id.get(name);
+    auto strings = reader->_string_id.get(name);
     if (strings.second != OTF2_CALLBACK_SUCCESS) {
         return strings.second;
     }
 
-    alldata->definitions.system_tree.insert_node(*strings.first[0], groupIdentifier,
+    alldata->definitions.system_tree.insert_node(reader->_string_id[strings.first[0]], groupIdentifier,
                                                  definitions::SystemClass::LOCATION_GROUP, systemTreeParent);
 
     return OTF2_CALLBACK_SUCCESS;
@@ -374,16 +410,17 @@ OTF2_CallbackCode OTF2Reader::handle_def_metric_class(  void*
 OTF2_CallbackCode OTF2Reader::handle_def_location(void* userData, OTF2_LocationRef locationIdentifier,
                                                   OTF2_StringRef name, OTF2_LocationType locationType,
                                                   uint64_t numberOfEvents, OTF2_LocationGroupRef locationGroup) {
-    auto* alldata = static_cast<AllData*>(userData);
+    auto* reader = static_cast<OTF2Reader*>(userData);
+    auto* alldata = reader->_alldata;
 
-    auto strings = string_id.get(name);
+    auto strings = reader->_string_id.get(name);
     if (strings.second != OTF2_CALLBACK_SUCCESS) {
         return strings.second;
     }
-    auto& location_name = *strings.first[0];
+    auto* location_name = reader->_string_id[strings.first[0]];
 
     ostringstream os;
-    if (location_name.length() == 0) {
+    if (*location_name == '\0') {
         // fix for semi broken traces with no location name
         switch (locationType) {
             case OTF2_LOCATION_TYPE_CPU_THREAD:
@@ -402,11 +439,17 @@ OTF2_CallbackCode OTF2Reader::handle_def_location(void* userData, OTF2_LocationR
         os << location_name;
     }
 
+    // not selected -> neither in the system tree nor read later on
+    if (!location_selected(alldata->params.locations, locationIdentifier, os.str(),
+                           alldata->definitions.system_tree.location_group(locationGroup)))
+        return OTF2_CALLBACK_SUCCESS;
+
     alldata->definitions.system_tree.insert_node(os.str(), locationIdentifier, definitions::SystemClass::LOCATION,
                                                  locationGroup);
 
     if (locationType == OTF2_LOCATION_TYPE_CPU_THREAD || locationType == OTF2_LOCATION_TYPE_GPU) {
-        locationList.push_back(locationIdentifier);
+        reader->_locations.push_back(locationIdentifier);
+        reader->_location_events.push_back(numberOfEvents);
     }
 
     return OTF2_CALLBACK_SUCCESS;
@@ -416,9 +459,14 @@ OTF2_CallbackCode OTF2Reader::handle_def_group(void* userData, OTF2_GroupRef gro
                                                OTF2_GroupType groupType, OTF2_Paradigm paradigm,
                                                OTF2_GroupFlag groupFlags, uint32_t numberOfMembers,
                                                const uint64_t* members) {
-    auto* alldata = static_cast<AllData*>(userData);
+    auto* reader = static_cast<OTF2Reader*>(userData);
+    auto* alldata = reader->_alldata;
 
-    auto strings = string_id.get(name);
+    // only the data dump writes groups
+    if (reader->_lazy_definitions && !alldata->params.data_dump)
+        return OTF2_CALLBACK_SUCCESS;
+
+    auto strings = reader->_string_id.get(name);
     if (strings.second != OTF2_CALLBACK_SUCCESS) {
         return strings.second;
     }
@@ -428,7 +476,8 @@ OTF2_CallbackCode OTF2Reader::handle_def_group(void* userData, OTF2_GroupRef gro
     for (uint32_t i = 0; i < numberOfMembers; ++i)
         members_vec[i] = members[i];
 
-    alldata->definitions.groups.add(groupIdentifier, {*strings.first[0], groupType, paradigm, std::move(members_vec)});
+    alldata->definitions.groups.add(groupIdentifier,
+                                    {reader->_string_id[strings.first[0]], groupType, paradigm, std::move(members_vec)});
 
     return OTF2_CALLBACK_SUCCESS;
 }
@@ -438,15 +487,31 @@ OTF2_CallbackCode OTF2Reader::handle_def_region(void* userData, OTF2_RegionRef r
                                                 OTF2_RegionRole regionRole, OTF2_Paradigm paradigm,
                                                 OTF2_RegionFlag regionFlags, OTF2_StringRef sourceFile,
                                                 uint32_t beginLineNumber, uint32_t endLineNumber) {
-    auto* alldata = static_cast<AllData*>(userData);
+    auto* reader = static_cast<OTF2Reader*>(userData);
+    auto* alldata = reader->_alldata;
 
-    auto strings = string_id.get(name, sourceFile);
+    auto strings = reader->_string_id.get(name, sourceFile, canonicalName);
     if (strings.second != OTF2_CALLBACK_SUCCESS) {
         return strings.second;
     }
 
-    alldata->definitions.regions.add(regionIdentifier,
-                                     {*strings.first[0], paradigm, beginLineNumber, *strings.first[1]});
+    definitions::Region region{strings.first[0], paradigm, beginLineNumber, strings.first[1]};
+
+    if (reader->_lazy_definitions)
+        add_pending(reader->_pending_regions, regionIdentifier, region);
+    else
+        alldata->definitions.regions.add(regionIdentifier, region);
+
+    // like Score-P: only user and compiler instrumentation is filtered, never MPI, OpenMP, ... regions
+    bool filterable = paradigm == OTF2_PARADIGM_USER || paradigm == OTF2_PARADIGM_COMPILER;
+    if (filterable && !reader->_region_filter.empty() &&
+        reader->_region_filter.excludes(reader->_string_id[strings.first[0]], reader->_string_id[strings.first[2]],
+                                        reader->_string_id[strings.first[1]])) {
+        if (regionIdentifier >= reader->_filtered_regions.size())
+            reader->_filtered_regions.resize(regionIdentifier + 1, false);
+
+        reader->_filtered_regions[regionIdentifier] = true;
+    }
 
     return OTF2_CALLBACK_SUCCESS;
 }
@@ -454,14 +519,16 @@ OTF2_CallbackCode OTF2Reader::handle_def_region(void* userData, OTF2_RegionRef r
 OTF2_CallbackCode OTF2Reader::handle_def_system_tree_node(void* userData, OTF2_SystemTreeNodeRef systemTreeIdentifier,
                                                           OTF2_StringRef name, OTF2_StringRef className,
                                                           OTF2_SystemTreeNodeRef parent) {
-    auto* alldata = static_cast<AllData*>(userData);
+    auto* reader = static_cast<OTF2Reader*>(userData);
+    auto* alldata = reader->_alldata;
 
-    auto strings = string_id.get(name, className);
+    auto strings = reader->_string_id.get(name, className);
     if (strings.second != OTF2_CALLBACK_SUCCESS) {
         return strings.second;
     }
 
-    auto& nameclass = *strings.first[1];
+    // copy -> the class name is shared by all nodes of the class
+    std::string nameclass = reader->_string_id[strings.first[1]];
 
     definitions::SystemClass classtype;
 
@@ -487,7 +554,7 @@ OTF2_CallbackCode OTF2Reader::handle_def_system_tree_node(void* userData, OTF2_S
         classtype = definitions::SystemClass::OTHER;
     }
 
-    nameclass.append(" " + *strings.first[0]);
+    nameclass.append(" ").append(reader->_string_id[strings.first[0]]);
     alldata->definitions.system_tree.insert_node(nameclass, systemTreeIdentifier, classtype, parent);
 
     return OTF2_CALLBACK_SUCCESS;
@@ -500,28 +567,31 @@ OTF2_CallbackCode OTF2Reader::handle_def_system_tree_node(void* userData, OTF2_S
     OTF2_CallbackCode OTF2Reader::handle_def_comm(void* userData, OTF2_CommRef self, OTF2_StringRef name,
                                                   OTF2_GroupRef group, OTF2_CommRef parent) {                       //OTF2 2.x
 #endif
-    auto* alldata                         = static_cast<AllData*>(userData);
+    auto* reader                          = static_cast<OTF2Reader*>(userData);
+    auto* alldata                         = reader->_alldata;
     alldata->metaData.communicators[self] = group;
 
     return OTF2_CALLBACK_SUCCESS;
 }
 
 OTF2_CallbackCode OTF2Reader::handle_def_string(void* userData, OTF2_StringRef stringIdentifier, const char* string) {
-    string_id.add(stringIdentifier, string);
+    auto* reader = static_cast<OTF2Reader*>(userData);
+    reader->_string_id.add(stringIdentifier, string);
 
     return OTF2_CALLBACK_SUCCESS;
 }
 
 OTF2_CallbackCode OTF2Reader::handle_def_paradigm(void* userData, OTF2_Paradigm paradigm, OTF2_StringRef name,
                                                   OTF2_ParadigmClass paradigmClass) {
-    auto* alldata = static_cast<AllData*>(userData);
-    auto  strings = string_id.get(name);
+    auto* reader = static_cast<OTF2Reader*>(userData);
+    auto* alldata = reader->_alldata;
+    auto  strings = reader->_string_id.get(name);
 
     if (strings.second != OTF2_CALLBACK_SUCCESS) {
         return strings.second;
     }
 
-    alldata->definitions.paradigms.add(paradigm, {*strings.first[0]});
+    alldata->definitions.paradigms.add(paradigm, {reader->_string_id[strings.first[0]]});
 
     return OTF2_CALLBACK_SUCCESS;
 }
@@ -531,22 +601,24 @@ OTF2_CallbackCode OTF2Reader::handle_def_io_paradigm(void* userData, OTF2_IoPara
                                                      OTF2_IoParadigmFlag flags, uint8_t numProperties,
                                                      const OTF2_IoParadigmProperty* properties, const OTF2_Type* types,
                                                      const OTF2_AttributeValue* values) {
-    auto* alldata = static_cast<AllData*>(userData);
-    auto  strings = string_id.get(name);
+    auto* reader = static_cast<OTF2Reader*>(userData);
+    auto* alldata = reader->_alldata;
+    auto  strings = reader->_string_id.get(name);
 
     if (strings.second != OTF2_CALLBACK_SUCCESS) {
         return strings.second;
     }
 
-    alldata->definitions.io_paradigms.add(paradigm, {*strings.first[0]});
+    alldata->definitions.io_paradigms.add(paradigm, {reader->_string_id[strings.first[0]]});
 
     return OTF2_CALLBACK_SUCCESS;
 }
 
 OTF2_CallbackCode OTF2Reader::handle_def_io_precreated_handle(void* userData, OTF2_IoHandleRef handle,
                                                               OTF2_IoAccessMode mode, OTF2_IoStatusFlag statusFlags) {
-    auto* alldata = static_cast<AllData*>(userData);
-    auto* ioh     = alldata->definitions.iohandles.get(handle);
+    auto* reader = static_cast<OTF2Reader*>(userData);
+    auto* alldata = reader->_alldata;
+    auto* ioh     = reader->ioHandle(handle);
     if (!ioh)
         return OTF2_CALLBACK_ERROR;
     switch (mode) {
@@ -578,22 +650,18 @@ OTF2_CallbackCode OTF2Reader::handle_def_io_precreated_handle(void* userData, OT
 /*                                                                    */
 /* ****************************************************************** */
 
-struct PendingIoEvt {
-    OTF2_TimeStamp begin_time;
-    uint64_t       bytes_request;
-};
-
-static std::map<uint64_t, PendingIoEvt> open_io_events;
-
 OTF2_CallbackCode OTF2Reader::handle_io_begin(OTF2_LocationRef locationID, OTF2_TimeStamp time, uint64_t eventPosition,
                                               void* userData, OTF2_AttributeList* attributeList,
                                               OTF2_IoHandleRef handle, OTF2_IoOperationMode mode,
                                               OTF2_IoOperationFlag flag, uint64_t bytesRequest, uint64_t matchingId) {
-    open_io_events[matchingId] = {time, bytesRequest};
-    auto* alldata              = static_cast<AllData*>(userData);
-    auto* h                    = alldata->definitions.iohandles.get(handle);
+    auto* state                       = static_cast<EventReaderState*>(userData);
+    state->open_io_events[matchingId] = {time, bytesRequest};
+    auto* h                           = state->reader->ioHandle(handle);
     if (!h)
         return OTF2_CALLBACK_ERROR;
+
+    std::lock_guard<std::mutex> lock(state->reader->_iohandle_mutex);
+    state->reader->hitIoHandle(handle);
     switch (mode) {
         case OTF2_IO_OPERATION_MODE_READ:
             h->modes.insert("R");
@@ -611,22 +679,22 @@ OTF2_CallbackCode OTF2Reader::handle_io_begin(OTF2_LocationRef locationID, OTF2_
 OTF2_CallbackCode OTF2Reader::handle_io_end(OTF2_LocationRef locationID, OTF2_TimeStamp time, uint64_t eventPosition,
                                             void* userData, OTF2_AttributeList* attributeList, OTF2_IoHandleRef handle,
                                             uint64_t bytesResult, uint64_t matchingId) {
-    auto* alldata     = static_cast<AllData*>(userData);
-    auto  found_start = open_io_events.find(matchingId);
-    if (found_start != open_io_events.end()) {
+    auto* state       = static_cast<EventReaderState*>(userData);
+    auto  found_start = state->open_io_events.find(matchingId);
+    if (found_start != state->open_io_events.end()) {
         auto duration  = time - found_start->second.begin_time;
         auto bytes_req = found_start->second.bytes_request;
-        open_io_events.erase(found_start);
-        auto h = alldata->definitions.iohandles.get(handle);
+        state->open_io_events.erase(found_start);
+        auto h = state->reader->ioHandle(handle);
         if (!h)
             return OTF2_CALLBACK_ERROR;  // event on undefined IO handle
-        uint64_t p = h->io_paradigm;
-        alldata->io_data[p].num_operations++;
+        auto& io_data = (*state->io_data)[h->io_paradigm];
+        io_data.num_operations++;
         if (bytesResult != OTF2_UNDEFINED_UINT64) {
-            alldata->io_data[p].num_bytes += bytesResult;
-            alldata->io_data[p].transfer_time += duration;
+            io_data.num_bytes += bytesResult;
+            io_data.transfer_time += duration;
         } else {
-            alldata->io_data[p].nontransfer_time += duration;
+            io_data.nontransfer_time += duration;
         }
     }
     return OTF2_CALLBACK_SUCCESS;
@@ -637,8 +705,13 @@ OTF2_CallbackCode OTF2Reader::handle_io_create_handle(OTF2_LocationRef locationI
                                                       OTF2_AttributeList* attributeList, OTF2_IoHandleRef handle,
                                                       OTF2_IoAccessMode mode, OTF2_IoCreationFlag creationFlags,
                                                       OTF2_IoStatusFlag statusFlags) {
-    auto* alldata = static_cast<AllData*>(userData);
-    auto* ioh     = alldata->definitions.iohandles.get(handle);
+    auto* state = static_cast<EventReaderState*>(userData);
+    auto* ioh   = state->reader->ioHandle(handle);
+    if (!ioh)
+        return OTF2_CALLBACK_ERROR;
+
+    std::lock_guard<std::mutex> lock(state->reader->_iohandle_mutex);
+    state->reader->hitIoHandle(handle);
     switch (mode) {
         case OTF2_IO_ACCESS_MODE_READ_ONLY:
             ioh->modes.insert("R");
@@ -662,139 +735,199 @@ OTF2_CallbackCode OTF2Reader::handle_io_create_handle(OTF2_LocationRef locationI
     return OTF2_CALLBACK_SUCCESS;
 }
 
-OTF2_CallbackCode OTF2Reader::handle_metric(OTF2_LocationRef locationID, OTF2_TimeStamp time, uint64_t eventPosition,
-                                            void* userData, OTF2_AttributeList* attributeList, OTF2_MetricRef metric,
-                                            uint8_t numberOfMetrics, const OTF2_Type* typeIDs,
-                                            const OTF2_MetricValue* metricValues) {
-    auto* alldata = static_cast<AllData*>(userData);
+// value of an OTF2 metric event in the slot type
+template <typename T>
+static T metric_value(const OTF2_MetricValue& value);
 
-    auto class_mapping = alldata->definitions.metric_classes.get(metric);
-    if (class_mapping != nullptr) {
-        auto* metric_class_def = alldata->definitions.metric_classes.get(metric);
+template <>
+inline uint64_t metric_value<uint64_t>(const OTF2_MetricValue& value) {
+    return value.unsigned_int;
+}
 
-        if(metric_class_def->metric_occurrence == MetricOccurrence::SYNCHRONOUS_STRICT){
+template <>
+inline int64_t metric_value<int64_t>(const OTF2_MetricValue& value) {
+    return value.signed_int;
+}
 
-            MetricDataType a_type;
+template <>
+inline double metric_value<double>(const OTF2_MetricValue& value) {
+    return value.floating_point;
+}
 
-            for (uint8_t i = 0; i < numberOfMetrics; i++) {
-                auto  metric_ref = class_mapping->metric_member.find(i);
-                auto* metric_def = alldata->definitions.metrics.get(metric_ref->second);
-                if (metric_ref != class_mapping->metric_member.end() && metric_def != nullptr && metric_def->allowed) {
-                    MetricData md;
+template <typename T>
+static inline void record_metric_values(const MetricLayout::Class& metric_class, const OTF2_MetricValue* metricValues,
+                                        uint8_t numberOfMetrics, MetricSample& sample) {
+    const auto& members = metric_class.of<T>();
+    auto&       values  = sample.values<T>();
 
-                    if (typeIDs[i] == OTF2_TYPE_UINT64) {
-                        md = {MetricDataType::UINT64, metricValues[i].unsigned_int, metricValues[i].unsigned_int};
-                    } else if (typeIDs[i] == OTF2_TYPE_INT64) {
-                        md = {MetricDataType::INT64, metricValues[i].signed_int, metricValues[i].signed_int};
-                    } else if (typeIDs[i] == OTF2_TYPE_DOUBLE) {
-                        md = {MetricDataType::DOUBLE, metricValues[i].floating_point, metricValues[i].floating_point};
-                    }
+    for (size_t i = 0; i < members.slots.size(); ++i) {
+        if (members.positions[i] < numberOfMetrics)
+            values[members.slots[i]] = metric_value<T>(metricValues[members.positions[i]]);
+    }
+}
 
-                    tmp_metric.insert(make_pair(metric_ref->second, md));
-                }
-            }
+// values of the other metric classes -> attributed to the call paths active over their sample interval
+static OTF2_CallbackCode handle_sampled_metric(EventReaderState* state, OTF2_TimeStamp time, OTF2_MetricRef metric,
+                                               uint8_t numberOfMetrics, const OTF2_Type* typeIDs,
+                                               const OTF2_MetricValue* metricValues) {
+    if (!state->metric_intervals.active())
+        return OTF2_CALLBACK_SUCCESS;
+
+    auto* members = state->metric_intervals.sampled()->metric_class(metric);
+    if (members == nullptr)
+        return OTF2_CALLBACK_SUCCESS;
+
+    for (const auto& member : *members) {
+        if (member.position >= numberOfMetrics)
+            continue;
+
+        const auto& value = metricValues[member.position];
+        switch (typeIDs[member.position]) {
+            case OTF2_TYPE_UINT64:
+                state->metric_intervals.sample(member, time, MetricDataType::UINT64, value.unsigned_int);
+                break;
+            case OTF2_TYPE_INT64:
+                state->metric_intervals.sample(member, time, MetricDataType::INT64, value.signed_int);
+                break;
+            case OTF2_TYPE_DOUBLE:
+                state->metric_intervals.sample(member, time, MetricDataType::DOUBLE, value.floating_point);
+                break;
+            default:
+                break;
         }
     }
 
     return OTF2_CALLBACK_SUCCESS;
 }
 
+// only strict synchronous metric classes have slots -> their values belong to the next enter/leave
+OTF2_CallbackCode OTF2Reader::handle_metric(OTF2_LocationRef locationID, OTF2_TimeStamp time, uint64_t eventPosition,
+                                            void* userData, OTF2_AttributeList* attributeList, OTF2_MetricRef metric,
+                                            uint8_t numberOfMetrics, const OTF2_Type* typeIDs,
+                                            const OTF2_MetricValue* metricValues) {
+    auto* state = static_cast<EventReaderState*>(userData);
+
+    if (state->metric_layout == nullptr)
+        return handle_sampled_metric(state, time, metric, numberOfMetrics, typeIDs, metricValues);
+
+    auto* metric_class = state->metric_layout->metric_class(metric);
+    if (metric_class == nullptr)
+        return handle_sampled_metric(state, time, metric, numberOfMetrics, typeIDs, metricValues);
+
+    record_metric_values<uint64_t>(*metric_class, metricValues, numberOfMetrics, state->metric_sample);
+    record_metric_values<int64_t>(*metric_class, metricValues, numberOfMetrics, state->metric_sample);
+    record_metric_values<double>(*metric_class, metricValues, numberOfMetrics, state->metric_sample);
+
+    state->metric_sample.record(metric_class);
+
+    return OTF2_CALLBACK_SUCCESS;
+}
+
 OTF2_CallbackCode OTF2Reader::handle_enter(OTF2_LocationRef locationID, OTF2_TimeStamp time, uint64_t eventPosition,
                                            void* userData, OTF2_AttributeList* attributeList, OTF2_RegionRef region)
 
 {
-    auto*      alldata = static_cast<AllData*>(userData);
+    auto*      state      = static_cast<EventReaderState*>(userData);
+    auto&      node_stack = state->node_stack;
+    auto&      sample     = state->metric_sample;
     tree_node* tmp_node;
 
+    // filtered region -> no node, its time stays in the exclusive time of the enclosing node
+    if (state->reader->isFiltered(region)) {
+        sample.clear();
+        return OTF2_CALLBACK_SUCCESS;
+    }
+
+    // too deep -> the frame is folded into the deepest node, its time counts as exclusive time there
+    auto max_depth = state->alldata->params.max_depth;
+    if (max_depth != 0 && node_stack.size() >= max_depth) {
+        ++node_stack.front().folded;
+        sample.clear();
+        return OTF2_CALLBACK_SUCCESS;
+    }
+
     if (!node_stack.empty()) {
         auto tmp = node_stack.front().node_p;
 
         auto tmp_child = tmp->children.find(region);
         if (tmp_child == tmp->children.end()) {
-            tmp_node = alldata->call_path_tree.insert_node(region, tmp);
+            tmp_node = state->call_path_tree->insert_node(region, tmp);
         } else {
-            tmp_node = tmp_child->second.get();
+            tmp_node = tmp_child->second;
         }
 
     } else {
-        auto root_node = alldata->call_path_tree.root_nodes.find(region);
+        auto root_node = state->call_path_tree->root_nodes.find(region);
 
-        if (root_node == alldata->call_path_tree.root_nodes.end()) {
-            tmp_node = alldata->call_path_tree.insert_node(region, nullptr);
+        if (root_node == state->call_path_tree->root_nodes.end()) {
+            tmp_node = state->call_path_tree->insert_node(region, nullptr);
         } else {
-            tmp_node = root_node->second.get();
+            tmp_node = root_node->second;
         }
     }
 
     tmp_node->add_data(locationID, FunctionData{0, 0, 0});
-    auto& node_metrics = tmp_node->last_data->metrics;
 
-    if (!tmp_metric.empty()) {
-        for (auto it : tmp_metric) {
-            auto metric_ref = node_metrics.find(it.first);
-
-            if (metric_ref == node_metrics.end()) {
-                metric_ref = node_metrics.insert(make_pair(it.first, MetricData{it.second.type})).first;
-            }
-
-            metric_ref->second -= it.second;
-
-            if (tmp_node->parent != nullptr) {
-                auto parent_metric_ref = tmp_node->parent->last_data->metrics.find(it.first);
-                parent_metric_ref->second.add_incl(it.second);
-            }
-        }
-
-        tmp_metric.clear();
+    if (!sample.empty()) {
+        tmp_node->add_metric_sample(locationID, sample, false);
+        sample.clear();
     }
 
-    node_stack.push_front({tmp_node, time, 0});
+    node_stack.push_front({tmp_node, time, 0, 0});
+
+    if (state->metric_intervals.active())
+        state->metric_intervals.set_node(time, tmp_node);
 
     return OTF2_CALLBACK_SUCCESS;
 }
 
 OTF2_CallbackCode OTF2Reader::handle_leave(OTF2_LocationRef locationID, OTF2_TimeStamp time, uint64_t eventPosition,
                                            void* userData, OTF2_AttributeList* attributeList, OTF2_RegionRef region) {
-    auto* alldata = static_cast<AllData*>(userData);
-
-    auto&    tmp       = node_stack.front();
-    uint64_t incl_time = time - tmp.time;
-    tmp.node_p->add_data(locationID, FunctionData{1, incl_time, incl_time - tmp.child_incl});
+    auto* state      = static_cast<EventReaderState*>(userData);
+    auto& node_stack = state->node_stack;
+    auto& sample     = state->metric_sample;
 
-    // ugly metric stuff
-    auto* tmp_node(tmp.node_p);
-    auto& node_metrics = tmp_node->last_data->metrics;
-    if (!tmp_metric.empty()) {
-        for (auto it = tmp_metric.begin(); it != tmp_metric.end(); it++) {
-            auto metric_ref = node_metrics.find(it->first);
+    if (state->reader->isFiltered(region)) {
+        sample.clear();
+        return OTF2_CALLBACK_SUCCESS;
+    }
 
-            if (metric_ref == node_metrics.end()) {
-                metric_ref = node_metrics.insert(make_pair(it->first, MetricData{it->second.type})).first;
-            }
+    auto& tmp = node_stack.front();
+    if (tmp.folded > 0) {
+        --tmp.folded;
+        sample.clear();
+        return OTF2_CALLBACK_SUCCESS;
+    }
 
-            metric_ref->second += it->second;
-            if (tmp_node->parent != nullptr) {
-                auto parent_metric_ref = tmp_node->parent->last_data->metrics.find(it->first);
-                parent_metric_ref->second.sub_incl(it->second);
-            }
-        }
+    uint64_t incl_time = time - tmp.time;
+    tmp.node_p->add_data(locationID, FunctionData{1, incl_time, incl_time - tmp.child_incl});
 
-        tmp_metric.clear();
+    // accumulated metrics -> inclusive value is the value at leave minus the value at enter
+    if (!sample.empty()) {
+        tmp.node_p->add_metric_sample(locationID, sample, true);
+        sample.clear();
     }
     node_stack.pop_front();
     if (!node_stack.empty()) {
         node_stack.front().child_incl += incl_time;
     }
 
+    if (state->metric_intervals.active())
+        state->metric_intervals.set_node(time, node_stack.empty() ? nullptr : node_stack.front().node_p);
+
     return OTF2_CALLBACK_SUCCESS;
 }
 
 OTF2_CallbackCode OTF2Reader::handle_mpi_send(OTF2_LocationRef locationID, OTF2_TimeStamp time, uint64_t eventPosition,
                                               void* userData, OTF2_AttributeList* attributeList, uint32_t receiver,
                                               OTF2_CommRef communicator, uint32_t msgTag, uint64_t msgLength) {
-    auto* alldata = static_cast<AllData*>(userData);
+    auto* state = static_cast<EventReaderState*>(userData);
 
-    auto& tmp = node_stack.front();
+    // outside of any (unfiltered) region -> no node to attribute the event to
+    if (state->node_stack.empty())
+        return OTF2_CALLBACK_SUCCESS;
+
+    auto& tmp = state->node_stack.front();
     tmp.node_p->add_data(locationID, MessageData{1, 0, msgLength, 0});
     // TODO workaround
     tmp.node_p->has_p2p = true;
@@ -805,9 +938,12 @@ OTF2_CallbackCode OTF2Reader::handle_mpi_send(OTF2_LocationRef locationID, OTF2_
 OTF2_CallbackCode OTF2Reader::handle_mpi_recv(OTF2_LocationRef locationID, OTF2_TimeStamp time, uint64_t eventPosition,
                                               void* userData, OTF2_AttributeList* attributeList, uint32_t sender,
                                               OTF2_CommRef communicator, uint32_t msgTag, uint64_t msgLength) {
-    auto* alldata = static_cast<AllData*>(userData);
+    auto* state = static_cast<EventReaderState*>(userData);
 
-    auto& tmp = node_stack.front();
+    if (state->node_stack.empty())
+        return OTF2_CALLBACK_SUCCESS;
+
+    auto& tmp = state->node_stack.front();
     tmp.node_p->add_data(locationID, MessageData{0, 1, 0, msgLength});
     // TODO workaround
     tmp.node_p->has_p2p = true;
@@ -819,9 +955,12 @@ OTF2_CallbackCode OTF2Reader::handle_mpi_isend(OTF2_LocationRef locationID, OTF2
                                                void* userData, OTF2_AttributeList* attributeList, uint32_t receiver,
                                                OTF2_CommRef communicator, uint32_t msgTag, uint64_t msgLength,
                                                uint64_t requestID) {
-    auto* alldata = static_cast<AllData*>(userData);
+    auto* state = static_cast<EventReaderState*>(userData);
 
-    auto& tmp = node_stack.front();
+    if (state->node_stack.empty())
+        return OTF2_CALLBACK_SUCCESS;
+
+    auto& tmp = state->node_stack.front();
     tmp.node_p->add_data(locationID, MessageData{1, 0, msgLength, 0});
     // TODO workaround
     tmp.node_p->has_p2p = true;
@@ -849,9 +988,12 @@ OTF2_CallbackCode OTF2Reader::handle_mpi_irecv(OTF2_LocationRef locationID, OTF2
                                                void* userData, OTF2_AttributeList* attributeList, uint32_t sender,
                                                OTF2_CommRef communicator, uint32_t msgTag, uint64_t msgLength,
                                                uint64_t requestID) {
-    auto* alldata = static_cast<AllData*>(userData);
+    auto* state = static_cast<EventReaderState*>(userData);
 
-    auto& tmp = node_stack.front();
+    if (state->node_stack.empty())
+        return OTF2_CALLBACK_SUCCESS;
+
+    auto& tmp = state->node_stack.front();
     tmp.node_p->add_data(locationID, MessageData{0, 1, 0, msgLength});
     // TODO workaround
     tmp.node_p->has_p2p = true;
@@ -891,9 +1033,12 @@ OTF2_CallbackCode OTF2Reader::handle_mpi_collective_end(OTF2_LocationRef locatio
     if (type == OTF2_COLLECTIVE_OP_BARRIER)
         return OTF2_CALLBACK_SUCCESS;
 
-    auto* alldata = static_cast<AllData*>(userData);
+    auto* state = static_cast<EventReaderState*>(userData);
 
-    auto& tmp = node_stack.front();
+    if (state->node_stack.empty())
+        return OTF2_CALLBACK_SUCCESS;
+
+    auto& tmp = state->node_stack.front();
 
     if (sizeSent > 0) {
         tmp.node_p->add_data(locationID, CollopData{1, 0, sizeSent, 0});
@@ -977,8 +1122,199 @@ OTF2_CallbackCode OTF2Reader::handle_unknown(OTF2_LocationRef locationID, OTF2_T
 
 */
 
+// slots for the members of all strict synchronous metric classes, in the order of the classes and their members
+void OTF2Reader::buildMetricLayout(AllData& alldata) {
+    _metric_layout = std::make_shared<MetricLayout>();
+
+    for (const auto& metric_class : alldata.definitions.metric_classes.get_all()) {
+        if (metric_class.second.metric_occurrence != MetricOccurrence::SYNCHRONOUS_STRICT)
+            continue;
+
+        std::vector<std::pair<uint8_t, uint64_t>> members;
+        for (const auto& member : metric_class.second.metric_member) {
+            auto* metric = alldata.definitions.metrics.get(member.second);
+            if (metric == nullptr || !metric->allowed)
+                continue;
+
+            _metric_layout->add_metric(member.second, metric->type);
+            members.push_back(std::make_pair(member.first, member.second));
+        }
+
+        _metric_layout->add_class(metric_class.first, members);
+    }
+
+    if (_metric_layout->empty()) {
+        _metric_layout.reset();
+        return;
+    }
+
+    alldata.call_path_tree.set_metric_layout(_metric_layout);
+    alldata.verbosePrint(1, true,
+                         "OTF2: " + std::to_string(_metric_layout->num_slots()) + " metric slots in " +
+                             std::to_string(_metric_layout->num_classes()) + " metric classes");
+}
+
+/*
+members of all other metric classes -> attributed over time, ABSOLUTE_* values become <unit>*s as DOUBLE.
+A metric that is also a member of a strict class already has its slot in the metric layout -> it is only recorded
+there, one value per row.
+*/
+void OTF2Reader::buildSampledMetrics(AllData& alldata) {
+    std::set<uint64_t> integrated;
+    for (const auto& metric_class : alldata.definitions.metric_classes.get_all()) {
+        if (metric_class.second.metric_occurrence == MetricOccurrence::SYNCHRONOUS_STRICT)
+            continue;
+
+        for (const auto& member : metric_class.second.metric_member) {
+            auto* metric = alldata.definitions.metrics.get(member.second);
+            if (metric == nullptr || !metric->allowed)
+                continue;
+
+            MetricDataType slot_type;
+            uint32_t       slot;
+            if (_metric_layout && _metric_layout->find(member.second, slot_type, slot))
+                continue;
+
+            _sampled_metrics.add_member(metric_class.first, member.first, member.second, metric->metricMode,
+                                        metric->type);
+
+            auto mode = metric->metricMode;
+            if (mode == MetricMode::ABSOLUTE_POINT || mode == MetricMode::ABSOLUTE_LAST ||
+                mode == MetricMode::ABSOLUTE_NEXT)
+                integrated.insert(member.second);
+        }
+    }
+
+    // after all classes -> a metric of several classes is rewritten once
+    for (auto metric_id : integrated) {
+        auto metric = *alldata.definitions.metrics.get(metric_id);
+        metric.type = MetricDataType::DOUBLE;
+        metric.unit = alldata.definitions.strings.intern(alldata.definitions.strings.str(metric.unit) + "*s");
+        alldata.definitions.metrics.add(metric_id, metric);
+    }
+
+    if (!_sampled_metrics.empty())
+        alldata.verbosePrint(1, true,
+                             "OTF2: " + std::to_string(_sampled_metrics.num_members()) +
+                                 " sampled metrics attributed by interval");
+}
+
+// sampled metrics are only added to the exclusive value of the active node -> inclusive values bottom up
+void OTF2Reader::sumSampledMetrics(AllData& alldata) {
+    auto& tree = alldata.call_path_tree;
+    tree.freeze();
+
+    const auto& order = tree.traversal();
+    for (size_t i = order.size(); i-- > 0;) {
+        auto* node = order[i].node;
+        if (node->parent == nullptr)
+            continue;
+
+        for (const auto& data : node->node_data) {
+            for (auto metric : data.second.metrics) {
+                if (!_sampled_metrics.contains(metric.first))
+                    continue;
+
+                MetricData incl = metric.second;
+                incl.data_excl  = MetricData::Data();
+
+                node->parent->metric(data.first, metric.first, incl.type) += incl;
+            }
+        }
+    }
+}
+
+const definitions::IoHandle* OTF2Reader::ioHandle(uint64_t handle) {
+    if (!_lazy_definitions)
+        return _alldata->definitions.iohandles.get(handle);
+
+    auto* pending = _pending_iohandles.get(handle);
+    return pending != nullptr ? &pending->definition : nullptr;
+}
+
+void OTF2Reader::hitIoHandle(uint64_t handle) {
+    if (!_lazy_definitions)
+        return;
+
+    auto* pending = _pending_iohandles.get(handle);
+    if (pending != nullptr)
+        _iohandle_hits[pending->ordinal] = 1;
+}
+
+/*
+--lazy-definitions: adds the recorded regions of the call path tree and the io handles used by events (and their
+parents) to the definitions. With MPI the hits of all ranks are combined -> every rank materializes the same ones.
+The raw strings and the recorded definitions are freed afterwards.
+*/
+void OTF2Reader::materializeDefinitions(AllData& alldata) {
+    if (!_lazy_definitions)
+        return;
+
+    auto num_regions = _pending_regions.size();
+
+    // hits by ordinal, regions first
+    std::vector<uint8_t> hits(num_regions + _pending_iohandles.size(), 0);
+
+    for (const auto& node : alldata.call_path_tree) {
+        auto* pending = _pending_regions.get(node.function_id);
+        if (pending != nullptr)
+            hits[pending->ordinal] = 1;
+    }
+
+    std::copy(_iohandle_hits.begin(), _iohandle_hits.end(), hits.begin() + num_regions);
+
+#ifdef OTFPROFILER_MPI
+    MPI_Allreduce(MPI_IN_PLACE, hits.data(), static_cast<int>(hits.size()), MPI_UNSIGNED_CHAR, MPI_BOR, MPI_COMM_WORLD);
+#endif
+
+    auto& defs = alldata.definitions;
+
+    for (const auto& pending : _pending_regions.get_all()) {
+        if (!hits[pending.second.ordinal])
+            continue;
+
+        const auto& region = pending.second.definition;
+        defs.regions.add(pending.first, {_string_id.intern(region.name), region.paradigm_id, region.source_line,
+                                         _string_id.intern(region.file_name)});
+    }
+
+    for (const auto& pending : _pending_iohandles.get_all()) {
+        if (!hits[num_regions + pending.second.ordinal])
+            continue;
+
+        // the file info of an io handle includes its parents
+        auto  id     = pending.first;
+        auto* handle = &pending.second;
+        while (handle != nullptr && defs.iohandles.get(id) == nullptr) {
+            auto materialized = handle->definition;
+            materialized.name = _string_id.intern(materialized.name);
+            defs.iohandles.add(id, materialized);
+
+            id     = materialized.parent;
+            handle = _pending_iohandles.get(id);
+        }
+    }
+
+    alldata.verbosePrint(1, true,
+                         "OTF2: " + std::to_string(defs.regions.size()) + " of " + std::to_string(num_regions) +
+                             " regions and " + std::to_string(defs.iohandles.size()) + " of " +
+                             std::to_string(_pending_iohandles.size()) + " io handles referenced");
+
+    _pending_regions    = {};
+    _pending_iohandles  = {};
+    _filesystem_entries = {};
+    std::vector<uint8_t>().swap(_iohandle_hits);
+    _string_id.clear();
+}
+
 bool OTF2Reader::readDefinitions(AllData& alldata) {
     alldata.verbosePrint(1, true, "OTF2: read definitions");
+    _alldata = &alldata;
+    _lazy_definitions = alldata.params.lazy_definitions;
+    _string_id.reset(&alldata.definitions.strings, _lazy_definitions);
+    _filesystem_entries = {};
+    _pending_regions    = {};
+    _pending_iohandles  = {};
 
     OTF2_ErrorCode status;
 
@@ -1070,7 +1406,7 @@ bool OTF2Reader::readDefinitions(AllData& alldata) {
     if (OTF2_SUCCESS != status)
         return false;
 
-    status = OTF2_Reader_RegisterGlobalDefCallbacks(_reader, glob_def_reader, glob_def_callbacks, &alldata);
+    status = OTF2_Reader_RegisterGlobalDefCallbacks(_reader, glob_def_reader, glob_def_callbacks, this);
     if (OTF2_SUCCESS != status)
         return false;
     uint64_t definitions_read = 0;
@@ -1084,19 +1420,286 @@ bool OTF2Reader::readDefinitions(AllData& alldata) {
 
     OTF2_Reader_CloseDefFiles(_reader);
 
+    if (_lazy_definitions) {
+        _iohandle_hits.assign(_pending_iohandles.size(), 0);
+        alldata.verbosePrint(2, true,
+                             "OTF2: " + std::to_string(_pending_regions.size()) + " regions and " +
+                                 std::to_string(_pending_iohandles.size()) + " io handles recorded, " +
+                                 std::to_string(_string_id.raw_bytes() / 1024) + " KiB of strings");
+    } else
+        alldata.verbosePrint(2, true,
+                             "OTF2: " + std::to_string(alldata.definitions.strings.size()) + " distinct strings, " +
+                                 std::to_string(alldata.definitions.strings.bytes() / 1024) + " KiB");
+
+    if (!alldata.params.locations.empty())
+        alldata.verbosePrint(1, true, "OTF2: " + std::to_string(_locations.size()) + " locations selected");
+
+    if (!_region_filter.empty()) {
+        auto filtered = std::count(_filtered_regions.begin(), _filtered_regions.end(), true);
+        alldata.verbosePrint(1, true, "OTF2: " + std::to_string(filtered) + " regions filtered");
+    }
+
+    buildMetricLayout(alldata);
+    buildSampledMetrics(alldata);
+
     return true;
 }
 
-bool OTF2Reader::readEvents(AllData& alldata) {
-    alldata.verbosePrint(1, true, "OTF2: read events");
+#ifdef OTFPROFILER_MPI
+/*
+ * Distributes the locations of a trace over all ranks, weighted by their number of events.
+ * The heaviest locations, covering at least half of all events and every location heavier than half a rank's
+ * share, are assigned statically (largest first to the least loaded rank). The remaining locations are handed out in chunks of shrinking size through a counter
+ * on rank 0, which evens out the difference between event count and actual reading time.
+ * All ranks build the same schedule, only the chunk number is communicated.
+ */
+class LocationScheduler {
+   public:
+    LocationScheduler(const std::vector<uint64_t>& locations, const std::vector<uint64_t>& events, uint32_t my_rank,
+                      uint32_t num_ranks)
+        : _locations(locations), _events(events) {
+        std::vector<size_t> order(locations.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+
+        std::sort(order.begin(), order.end(), [&events, &locations](size_t lhs, size_t rhs) {
+            return events[lhs] != events[rhs] ? events[lhs] > events[rhs] : locations[lhs] < locations[rhs];
+        });
+
+        uint64_t total_events = 0;
+        for (const auto num : events)
+            total_events += num;
+
+        // <load, rank> -> least loaded rank on top
+        using Load = std::pair<uint64_t, uint32_t>;
+        std::priority_queue<Load, std::vector<Load>, std::greater<Load>> loads;
+        for (uint32_t rank = 0; rank < num_ranks; ++rank)
+            loads.push({0, rank});
+
+        uint64_t assigned = 0;
+        size_t   pos      = 0;
+        for (; pos < order.size(); ++pos) {
+            if (assigned >= total_events / 2 && events[order[pos]] * 2 * num_ranks < total_events)
+                break;
+
+            auto least = loads.top();
+            loads.pop();
+
+            if (least.second == my_rank)
+                _static.push_back(order[pos]);
+
+            least.first += events[order[pos]];
+            assigned += events[order[pos]];
+            loads.push(least);
+        }
+
+        _dynamic.assign(order.begin() + pos, order.end());
+
+        // guided chunks -> large at the beginning, single locations at the end
+        for (size_t begin = 0; begin < _dynamic.size();) {
+            size_t remaining = _dynamic.size() - begin;
+            size_t size      = std::max<size_t>(1, remaining / (2 * num_ranks));
+
+            _chunks.push_back({begin, begin + size});
+            begin += size;
+        }
+
+        MPI_Win_allocate(my_rank == 0 ? sizeof(uint64_t) : 0, sizeof(uint64_t), MPI_INFO_NULL, MPI_COMM_WORLD,
+                         &_counter, &_window);
+        if (my_rank == 0)
+            *_counter = 0;
+
+        MPI_Win_fence(0, _window);
+        MPI_Win_lock_all(0, _window);
+    }
+
+    // hands out the next location to read, false if there is nothing left
+    bool next(uint64_t& location) {
+        size_t index;
+
+        if (_static_pos < _static.size()) {
+            index = _static[_static_pos++];
+        } else {
+            if (_chunk_pos == _chunk_end && !claimChunk())
+                return false;
+
+            index = _dynamic[_chunk_pos++];
+        }
+
+        location = _locations[index];
+        ++locations_read;
+        events_read += _events[index];
+
+        return true;
+    }
+
+    LocationScheduler(const LocationScheduler&) = delete;
+    LocationScheduler& operator=(const LocationScheduler&) = delete;
+
+    ~LocationScheduler() { finish(); }
+
+    // collective -> must be called by all ranks, at the latest by the destructor
+    void finish() {
+        if (_window == MPI_WIN_NULL)
+            return;
+
+        MPI_Win_unlock_all(_window);
+        MPI_Win_free(&_window);
+    }
+
+    uint64_t locations_read = 0;
+    uint64_t events_read    = 0;
+
+   private:
+    bool claimChunk() {
+        const uint64_t one = 1;
+        uint64_t       chunk;
+
+        MPI_Fetch_and_op(&one, &chunk, MPI_UINT64_T, 0, 0, MPI_SUM, _window);
+        MPI_Win_flush(0, _window);
+
+        if (chunk >= _chunks.size())
+            return false;
+
+        _chunk_pos = _chunks[chunk].first;
+        _chunk_end = _chunks[chunk].second;
+
+        return true;
+    }
+
+    const std::vector<uint64_t>& _locations;
+    const std::vector<uint64_t>& _events;
+
+    // indices into _locations
+    std::vector<size_t>                     _static;
+    std::vector<size_t>                     _dynamic;
+    std::vector<std::pair<size_t, size_t>> _chunks;
+
+    size_t _static_pos = 0;
+    size_t _chunk_pos  = 0;
+    size_t _chunk_end  = 0;
+
+    uint64_t* _counter;
+    MPI_Win   _window = MPI_WIN_NULL;
+};
+#endif
+
+bool OTF2Reader::readLocation(EventReaderState& state, OTF2_EvtReaderCallbacks* evt_callbacks, uint64_t location) {
+    state.metric_intervals.reset(&_sampled_metrics, location, state.alldata->metaData.timerResolution);
+
+    /*
+     * read local definitions of that location before reading local events
+     * reading local definition enables the internal mapping of OTF2 between local and global definitions
+     */
+    OTF2_DefReader* local_def_reader = OTF2_Reader_GetDefReader(_reader, location);
+    if (NULL != local_def_reader) {
+        uint64_t       definitions_read;
+        OTF2_ErrorCode status = OTF2_Reader_ReadAllLocalDefinitions(_reader, local_def_reader, &definitions_read);
+        if (OTF2_SUCCESS != status) {
+            std::cerr << "ERROR: Could not read local definitions from OTF2 trace." << std::endl;
+            return false;
+        }
+
+        OTF2_Reader_CloseDefReader(_reader, local_def_reader);
+    }
+
+    OTF2_EvtReader* local_evt_reader = OTF2_Reader_GetEvtReader(_reader, location);
+    if (NULL == local_evt_reader)
+        return false;
+
+    uint64_t       events_read;
+    OTF2_ErrorCode status = OTF2_Reader_RegisterEvtCallbacks(_reader, local_evt_reader, evt_callbacks, &state);
+    if (OTF2_SUCCESS != status)
+        std::cerr << "ERROR: Could not register the event callbacks of location " << location << "." << std::endl;
+    else {
+        status = OTF2_Reader_ReadLocalEvents(_reader, local_evt_reader, OTF2_UNDEFINED_UINT64, &events_read);
+
+        if (OTF2_SUCCESS != status)
+            std::cerr << "ERROR: Could not read the events of location " << location << " from OTF2 trace."
+                      << std::endl;
+    }
+
+    OTF2_Reader_CloseEvtReader(_reader, local_evt_reader);
+
+    state.node_stack.clear();
+    state.metric_sample.clear();
+    state.open_io_events.clear();
+
+    // a partly read location would leave a truncated profile
+    return OTF2_SUCCESS == status;
+}
+
+bool OTF2Reader::readLocations(AllData& alldata, OTF2_EvtReaderCallbacks* evt_callbacks,
+                               const std::function<bool(uint64_t&)>& next_location) {
+    if (alldata.params.num_threads <= 1) {
+        EventReaderState state(*this, alldata, alldata.call_path_tree, alldata.io_data);
+        uint64_t         location;
+
+        while (next_location(location)) {
+            if (!readLocation(state, evt_callbacks, location))
+                return false;
+        }
+
+        return true;
+    }
+
+    struct Worker {
+        data_tree                  call_path_tree;
+        std::map<uint64_t, IoData> io_data;
+    };
+
+    std::vector<Worker>      workers(alldata.params.num_threads);
+    std::vector<std::thread> threads;
+
+    for (auto& worker : workers) {
+        worker.call_path_tree.set_locations(alldata.call_path_tree.locations());
+        worker.call_path_tree.set_metric_layout(alldata.call_path_tree.metric_layout());
+    }
+    std::mutex               next_mutex;
+    std::atomic<bool>        failed{false};
+
+    for (auto& worker : workers) {
+        threads.emplace_back([&](Worker* w) {
+            EventReaderState state(*this, alldata, w->call_path_tree, w->io_data);
+            uint64_t         location;
+
+            while (!failed) {
+                {
+                    std::lock_guard<std::mutex> lock(next_mutex);
+                    if (!next_location(location))
+                        break;
+                }
+
+                if (!readLocation(state, evt_callbacks, location))
+                    failed = true;
+            }
+        }, &worker);
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    // every location was read by exactly one thread -> node data of the trees is disjoint
+    for (auto& worker : workers) {
+        alldata.call_path_tree.merge_tree(worker.call_path_tree);
+
+        for (const auto& io : worker.io_data)
+            alldata.io_data[io.first] += io.second;
+    }
 
-    uint64_t otf2_STEP = OTF2_UNDEFINED_UINT64;
-    uint64_t events_read;
+    return !failed;
+}
+
+struct EvtCallbacksDeleter {
+    void operator()(OTF2_EvtReaderCallbacks* callbacks) const { OTF2_EvtReaderCallbacks_Delete(callbacks); }
+};
 
-    OTF2_ErrorCode  status;
-    OTF2_EvtReader* local_evt_reader;
+bool OTF2Reader::readEvents(AllData& alldata) {
+    alldata.verbosePrint(1, true, "OTF2: read events");
 
-    OTF2_EvtReaderCallbacks* evt_callbacks = OTF2_EvtReaderCallbacks_New();
+    // deleted on every return -> a failed trace of --batch leaks nothing
+    std::unique_ptr<OTF2_EvtReaderCallbacks, EvtCallbacksDeleter> callbacks(OTF2_EvtReaderCallbacks_New());
+    OTF2_EvtReaderCallbacks* evt_callbacks = callbacks.get();
 
     if (NULL == evt_callbacks)
         return false;
@@ -1125,107 +1728,70 @@ bool OTF2Reader::readEvents(AllData& alldata) {
     OTF2_EvtReaderCallbacks_SetIoOperationBeginCallback(evt_callbacks, handle_io_begin);
     OTF2_EvtReaderCallbacks_SetIoOperationCompleteCallback(evt_callbacks, handle_io_end);
     OTF2_EvtReaderCallbacks_SetIoCreateHandleCallback(evt_callbacks, handle_io_create_handle);
-#ifndef OTFPROFILE_MPI
-
-    OTF2_DefReader* local_def_reader;
-
-    for (const auto location : locationList) {
-        local_def_reader = OTF2_Reader_GetDefReader(_reader, location);
-        uint64_t definitions_read;
-        status = OTF2_Reader_ReadAllLocalDefinitions(_reader, local_def_reader, &definitions_read);
-        if (OTF2_SUCCESS != status) {
-            std::cerr << "ERROR: Could not read local definitions from OTF2 trace." << std::endl;
-            return false;
-        }
-
-        local_evt_reader = OTF2_Reader_GetEvtReader(_reader, location);
+#ifndef OTFPROFILER_MPI
 
-        if (NULL == local_evt_reader)
+    std::atomic<size_t> next{0};
+    auto                next_location = [this, &next](uint64_t& location) {
+        auto pos = next++;
+        if (pos >= _locations.size())
             return false;
 
-        status = OTF2_Reader_RegisterEvtCallbacks(_reader, local_evt_reader, evt_callbacks, &alldata);
-        status = OTF2_Reader_ReadLocalEvents(_reader, local_evt_reader, otf2_STEP, &events_read);
-        node_stack.clear();
-
-        if (OTF2_SUCCESS != status)
-            std::cerr << "Error while reading events from OTF2 trace." << std::endl;
-    }
-    /* Clean up */
-    OTF2_EvtReaderCallbacks_Delete(evt_callbacks);
+        location = _locations[pos];
+        return true;
+    };
 
 #else
 
-    MPI_Win shared_space;
-
-    uint64_t* val_p;
-
-    uint64_t to_read = 0;
-    uint64_t initial = -1;
-    uint64_t result;
+    LocationScheduler scheduler(_locations, _location_events, alldata.metaData.myRank, alldata.metaData.numRanks);
+    auto next_location = [&scheduler](uint64_t& location) { return scheduler.next(location); };
 
-    if (alldata.metaData.myRank == 0) {
-        MPI_Win_allocate(sizeof(uint64_t), sizeof(uint64_t), MPI_INFO_NULL, MPI_COMM_WORLD, &val_p, &shared_space);
-        MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, shared_space);
-        MPI_Put(&initial, 1, MPI_LONG_LONG_INT, 0, 0, 1, MPI_LONG_LONG_INT, shared_space);
-        MPI_Win_unlock(0, shared_space);
-    } else {
-        MPI_Win_allocate(0, sizeof(uint64_t), MPI_INFO_NULL, MPI_COMM_WORLD, &val_p, &shared_space);
-    }
-
-    MPI_Win_fence(0, shared_space);
-    MPI_Win_lock_all(0, shared_space);
-
-    while (to_read < locationList.size()) {
-        MPI_Compare_and_swap(&to_read, &initial, &result, MPI_LONG_LONG_INT, 0, 0, shared_space);
-        if (result == initial) {
-            /*
-             * read local definitions of that rank before reading local events
-             * reading local definition enables the internal mapping of OTF2 between local and global definitions
-             * ->necessary and !NOT! mandatory
-             */
-            OTF2_DefReader* local_def_reader;
-            local_def_reader = OTF2_Reader_GetDefReader(_reader, locationList[to_read]);
-            uint64_t definitions_read;
-            status = OTF2_Reader_ReadAllLocalDefinitions(_reader, local_def_reader, &definitions_read);
-            if (OTF2_SUCCESS != status) {
-                std::cerr << "ERROR: Could not read local definitions from OTF2 trace." << std::endl;
-                return false;
-            }
-
-            status = OTF2_Reader_CloseDefReader(_reader, local_def_reader);
-            if (OTF2_SUCCESS != status) {
-                return false;
-            }
-            // end local def reading
-
-            local_evt_reader = OTF2_Reader_GetEvtReader(_reader, locationList[to_read]);
-            if (NULL == local_evt_reader)
-                return false;
+    double start_time = MPI_Wtime();
 
-            status = OTF2_Reader_RegisterEvtCallbacks(_reader, local_evt_reader, evt_callbacks, &alldata);
-            status = OTF2_Reader_ReadLocalEvents(_reader, local_evt_reader, otf2_STEP, &events_read);
+#endif
 
-            if (OTF2_SUCCESS != status) {
-                std::cerr << "Error while reading events from OTF2 trace." << std::endl;
-            }
+    if (alldata.params.num_threads > 1)
+        alldata.verbosePrint(2, true, "OTF2: reading locations with " + std::to_string(alldata.params.num_threads) +
+                                          " threads per process");
 
-            node_stack.clear();
-            initial = to_read;
-            ++to_read;
+    bool read = readLocations(alldata, evt_callbacks, next_location);
 
-        } else {
-            MPI_Get(&initial, 1, MPI_LONG_LONG_INT, 0, 0, 1, MPI_LONG_LONG_INT, shared_space);
-            to_read = initial + 1;
+#ifndef OTFPROFILER_MPI
+    if (!read)
+        return false;
+#else
+    double busy_time = MPI_Wtime() - start_time;
+
+    if (alldata.params.verbose_level >= 2) {
+        // the barrier makes the waiting time of ranks that finished early visible
+        MPI_Barrier(MPI_COMM_WORLD);
+        double idle_time = MPI_Wtime() - start_time - busy_time;
+
+        double              stats[4] = {(double)scheduler.locations_read, (double)scheduler.events_read, busy_time,
+                           idle_time};
+        std::vector<double> all_stats(alldata.metaData.myRank == 0 ? 4 * alldata.metaData.numRanks : 0);
+        MPI_Gather(stats, 4, MPI_DOUBLE, all_stats.data(), 4, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+        for (uint32_t rank = 0; rank < all_stats.size() / 4; ++rank) {
+            ostringstream os;
+            os << "OTF2: rank " << rank << " read " << (uint64_t)all_stats[4 * rank] << " locations with "
+               << (uint64_t)all_stats[4 * rank + 1] << " events in " << all_stats[4 * rank + 2] << "s, idle "
+               << all_stats[4 * rank + 3] << "s";
+            alldata.verbosePrint(2, true, os.str());
         }
     }
 
-    /* Clean up */
-    MPI_Win_unlock_all(shared_space);
-    MPI_Win_free(&shared_space);
-    OTF2_EvtReaderCallbacks_Delete(evt_callbacks);
+    // a rank whose locations failed still takes part in the collectives above
+    scheduler.finish();
 
+    if (!read)
+        return false;
 #endif
 
+    if (!_sampled_metrics.empty())
+        sumSampledMetrics(alldata);
+
+    materializeDefinitions(alldata);
+
     /*
      * Callbacks not implemented yet
      *
@@ -7,7 +7,7 @@
 
 #include <otfaux.h>
 
-#ifdef OTFPROFILE_MPI
+#ifdef OTFPROFILER_MPI
 #include <mpi.h>
 #endif
 using namespace std;
@@ -16,7 +16,10 @@ static uint64_t                                  systemTreeNodeId = -1;
 static std::vector<uint64_t>                     myProcessesList;
 static map<uint64_t, vector<MetricData>>         tmp_metric;
 static std::vector<uint64_t>                     locationList;
+static std::vector<std::vector<uint64_t>>        locationProcesses;  // processes of each stream in locationList
 static std::map<uint64_t, std::deque<StackData>> global_node_stack;
+static RegionFilter                              regionFilter;
+static std::vector<bool>                         filteredRegions;  // --filter-file, per function id
 
 bool OTFReader::initialize(AllData &alldata) {
     alldata.verbosePrint(1, true, "OTF: reader initalization");
@@ -53,11 +56,26 @@ bool OTFReader::initialize(AllData &alldata) {
         return false;
     }
 
+    // state left over from a previous trace (batch mode)
+    systemTreeNodeId = -1;
+    myProcessesList.clear();
+    tmp_metric.clear();
+    locationList.clear();
+    locationProcesses.clear();
+    global_node_stack.clear();
+    regionFilter = RegionFilter();
+    filteredRegions.clear();
+
+    if (!alldata.params.filter_file.empty() && !regionFilter.load(alldata.params.filter_file))
+        return false;
+
     /* fill the global array of processes */
 
     locationList.reserve(master->n);
-    for (auto i = 0; i < master->n; ++i)
+    for (auto i = 0; i < master->n; ++i) {
         locationList.push_back(master->map[i].argument);
+        locationProcesses.emplace_back(master->map[i].values, master->map[i].values + master->map[i].n);
+    }
 
     /* close OTF master control and file manager */
     OTF_MasterControl_close(master);
@@ -120,13 +138,15 @@ int OTFReader::handle_def_process(void *fha, uint32_t stream, uint32_t process,
 
         alldata->definitions.system_tree.insert_node(name, systemTreeNodeId, definitions::SystemClass::LOCATION_GROUP,
                                                      0);
-        alldata->definitions.system_tree.insert_node(name, process, definitions::SystemClass::LOCATION,
-                                                     systemTreeNodeId);
-    } else {
-        alldata->definitions.system_tree.insert_node(name, process, definitions::SystemClass::LOCATION,
-                                                     systemTreeNodeId);
     }
 
+    // not selected -> not in the system tree, its stream is skipped if no other process of it is selected
+    if (!location_selected(alldata->params.locations, process, name,
+                           alldata->definitions.system_tree.location_group(systemTreeNodeId)))
+        return OTF_RETURN_OK;
+
+    alldata->definitions.system_tree.insert_node(name, process, definitions::SystemClass::LOCATION, systemTreeNodeId);
+
     return OTF_RETURN_OK;
 }
 /*TODO Reimplementation mit Anpassung auf OTF2
@@ -153,7 +173,15 @@ int OTFReader::handle_def_function(void *fha, uint32_t stream, uint32_t function
                                    uint32_t source, OTF_KeyValueList *kvlist) {
     auto *alldata = static_cast<AllData *>(fha);
     // TODO better solution necessary -> funcGroup is used as pradigm here
-    alldata->definitions.regions.add(function, {name, funcGroup, source, ""});
+    alldata->definitions.regions.add(function, {alldata->definitions.strings.intern(name), funcGroup, source, {}});
+
+    // OTF has no file names in function definitions -> only region name rules apply
+    if (!regionFilter.empty() && regionFilter.excludes(name, name, "")) {
+        if (function >= filteredRegions.size())
+            filteredRegions.resize(function + 1, false);
+
+        filteredRegions[function] = true;
+    }
 
     return OTF_RETURN_OK;
 }
@@ -181,7 +209,8 @@ int OTFReader::handle_def_counter(void *fha, uint32_t stream, uint32_t counter,
                 a_type = MetricDataType::DOUBLE;
             }
 
-            alldata->definitions.metrics.add(counter, {name, "" /*description*/, "" /*unit*/, a_type, true});
+            alldata->definitions.metrics.add(
+                counter, {alldata->definitions.strings.intern(name), {} /*description*/, {} /*unit*/, a_type, true});
         }
     }
 
@@ -202,15 +231,34 @@ int OTFReader::handle_def_keyvalue(void *fha, uint32_t stream, uint32_t key, OTF
 /*                                                                    */
 /* ****************************************************************** */
 
+// --locations: a stream may contain selected and unselected processes -> the events of unselected ones are dropped
+static bool unselected(AllData *alldata, uint32_t process) {
+    return !alldata->params.locations.empty() && alldata->definitions.system_tree.location(process) == nullptr;
+}
+
 int OTFReader::handle_enter(void *fha, uint64_t time, uint32_t function, uint32_t process, uint32_t source,
                             OTF_KeyValueList *kvlist) {
     auto *alldata = static_cast<AllData *>(fha);
 
+    if (unselected(alldata, process))
+        return OTF_RETURN_OK;
+
+    // filtered function -> no node, its time stays in the exclusive time of the enclosing node
+    if (function < filteredRegions.size() && filteredRegions[function])
+        return OTF_RETURN_OK;
+
     tree_node *tmp_node;
     // explezit kein find benutzt -> subscript operator null-initialisiert wenn nichts vorhanden ist -> sonst gleiches
     // verhalten
     auto &local_stack = global_node_stack[process];
 
+    // too deep -> the frame is folded into the deepest node, its time counts as exclusive time there
+    auto max_depth = alldata->params.max_depth;
+    if (max_depth != 0 && local_stack.size() >= max_depth) {
+        ++local_stack.front().folded;
+        return OTF_RETURN_OK;
+    }
+
     if (!local_stack.empty()) {
         auto tmp       = local_stack.front().node_p;
         auto tmp_child = tmp->children.find(function);
@@ -218,7 +266,7 @@ int OTFReader::handle_enter(void *fha, uint64_t time, uint32_t function, uint32_
         if (tmp_child == tmp->children.end()) {
             tmp_node = alldata->call_path_tree.insert_node((uint64_t)function, tmp);
         } else {
-            tmp_node = tmp_child->second.get();
+            tmp_node = tmp_child->second;
         }
     } else {
         auto root_node = alldata->call_path_tree.root_nodes.find(function);
@@ -226,12 +274,12 @@ int OTFReader::handle_enter(void *fha, uint64_t time, uint32_t function, uint32_
         if (root_node == alldata->call_path_tree.root_nodes.end()) {
             tmp_node = alldata->call_path_tree.insert_node((uint64_t)function, nullptr);
         } else {
-            tmp_node = root_node->second.get();
+            tmp_node = root_node->second;
         }
     }
 
     tmp_node->add_data(process, FunctionData{0, 0, 0});
-    local_stack.push_front({tmp_node, time, 0});
+    local_stack.push_front({tmp_node, time, 0, 0});
 
     return OTF_RETURN_OK;
 }
@@ -240,35 +288,35 @@ int OTFReader::handle_leave(void *fha, uint64_t time, uint32_t function, uint32_
                             OTF_KeyValueList *kvlist) {
     auto *alldata = static_cast<AllData *>(fha);
 
+    if (unselected(alldata, process))
+        return OTF_RETURN_OK;
+
+    // counter values are kept -> they count for the enclosing node at its leave
+    if (function < filteredRegions.size() && filteredRegions[function])
+        return OTF_RETURN_OK;
+
     // implizite annahme das sich beim leaver immer min. ein element im stack befindet -> sonst seg. fault
     auto &   local_stack = global_node_stack.find(process)->second;
     auto &   tmp         = local_stack.front();
+    if (tmp.folded > 0) {
+        --tmp.folded;
+        return OTF_RETURN_OK;
+    }
+
     uint64_t incl_time   = time - tmp.time;
     tmp.node_p->add_data(process, FunctionData{1, incl_time, incl_time - tmp.child_incl});
 
     // metric-counter stuff
-    auto  tmp_node(tmp.node_p);
-    auto &node_metrics = tmp_node->last_data->metrics;
+    auto tmp_node(tmp.node_p);
 
     for (auto it = tmp_metric.begin(); it != tmp_metric.end(); ++it) {
         // TODO produziert segfaults wenn die metriken nicht strikt synchron sind
         MetricData incl_metric(it->second.back());
         incl_metric -= it->second.front();
-        auto metric_ref = node_metrics.find(it->first);
-
-        if (metric_ref == node_metrics.end()) {
-            metric_ref = node_metrics.insert(make_pair(it->first, MetricData{incl_metric.type})).first;
-        }
 
-        metric_ref->second += incl_metric;
+        tmp_node->metric(process, it->first, incl_metric.type) += incl_metric;
         if (tmp_node->parent != nullptr) {
-            auto parent_metric_ref = tmp_node->parent->last_data->metrics.find(it->first);
-            if (parent_metric_ref == tmp_node->parent->last_data->metrics.end()) {
-                parent_metric_ref =
-                    tmp_node->parent->last_data->metrics.insert(make_pair(it->first, MetricData{incl_metric.type}))
-                        .first;
-            }
-            parent_metric_ref->second.add_incl(incl_metric);
+            tmp_node->parent->metric(process, it->first, incl_metric.type).add_incl(incl_metric);
         }
         it->second.clear();
     }
@@ -286,6 +334,9 @@ int OTFReader::handle_counter(void *fha, uint64_t time, uint32_t process, uint32
                               OTF_KeyValueList *kvlist) {
     auto *alldata = static_cast<AllData *>(fha);
 
+    if (unselected(alldata, process))
+        return OTF_RETURN_OK;
+
     auto *counter_ref = alldata->definitions.metrics.get(counter);
 
     if (counter_ref != nullptr) {
@@ -345,6 +396,9 @@ int OTFReader::handle_send(void *fha, uint64_t time, uint32_t sender, uint32_t r
                            uint32_t length, uint32_t source, OTF_KeyValueList *kvlist) {
     auto *alldata = static_cast<AllData *>(fha);
 
+    if (unselected(alldata, sender))
+        return OTF_RETURN_OK;
+
     auto &tmp = global_node_stack.find(sender)->second.front();
     tmp.node_p->add_data(sender, MessageData{1, 0, length, 0});
 
@@ -358,6 +412,9 @@ int OTFReader::handle_recv(void *fha, uint64_t time, uint32_t receiver, uint32_t
                            uint32_t length, uint32_t source, OTF_KeyValueList *kvlist) {
     auto *alldata = static_cast<AllData *>(fha);
 
+    if (unselected(alldata, receiver))
+        return OTF_RETURN_OK;
+
     auto &tmp = global_node_stack.find(receiver)->second.front();
     tmp.node_p->add_data(receiver, MessageData{0, 1, 0, length});
 
@@ -372,6 +429,9 @@ int OTFReader::handle_collop(void *fha, uint64_t time, uint32_t process, uint32_
                              OTF_KeyValueList *kvlist) {
     auto *alldata = static_cast<AllData *>(fha);
 
+    if (unselected(alldata, process))
+        return OTF_RETURN_OK;
+
     auto &tmp = global_node_stack.find(process)->second.front();
 
     if (sent > 0) {
@@ -495,6 +555,22 @@ bool OTFReader::readDefinitions(AllData &alldata) {
 bool OTFReader::readEvents(AllData &alldata) {
     alldata.verbosePrint(1, true, "OTF: read events");
 
+    // --locations: only streams with at least one selected process (-> in the system tree) are opened
+    if (!alldata.params.locations.empty()) {
+        std::vector<uint64_t> selected;
+        for (size_t i = 0; i < locationList.size(); ++i) {
+            for (auto process : locationProcesses[i]) {
+                if (alldata.definitions.system_tree.location(process) != nullptr) {
+                    selected.push_back(locationList[i]);
+                    break;
+                }
+            }
+        }
+
+        locationList.swap(selected);
+        alldata.verbosePrint(1, true, "OTF: " + std::to_string(locationList.size()) + " streams selected");
+    }
+
     /* open OTF handler array */
     OTF_HandlerArray *handlers = OTF_HandlerArray_open();
     assert(handlers);
@@ -542,7 +618,7 @@ bool OTFReader::readEvents(AllData &alldata) {
     /* select processes to read */
     uint64_t records_read = 0;
 
-#ifdef OTFPROFILE_MPI
+#ifdef OTFPROFILER_MPI
 
     MPI_Win shared_space;
 
@@ -564,6 +640,9 @@ bool OTFReader::readEvents(AllData &alldata) {
     MPI_Win_fence(0, shared_space);
     MPI_Win_lock_all(0, shared_space);
 
+    // the window is freed collectively -> a failed stream ends the loop instead of returning
+    bool failed = false;
+
     while (to_read < locationList.size()) {
         MPI_Compare_and_swap(&to_read, &initial, &result, MPI_LONG_LONG_INT, 0, 0, shared_space);
 
@@ -571,9 +650,12 @@ bool OTFReader::readEvents(AllData &alldata) {
             auto areader = OTF_RStream_open(alldata.params.input_file_prefix.c_str(), locationList[to_read], _manager);
 
             if (OTF_RStream_readEvents(areader, handlers) == 0) {
-                return false;
+                OTF_RStream_close(areader);
+                failed = true;
+                break;
             }
 
+            OTF_RStream_close(areader);
             initial = to_read;
             ++to_read;
             global_node_stack.clear();
@@ -587,6 +669,9 @@ bool OTFReader::readEvents(AllData &alldata) {
     MPI_Win_unlock_all(shared_space);
     MPI_Win_free(&shared_space);
 
+    if (failed)
+        return false;
+
 #else
 
     // processes (locations in OTF2) start with 1 rather then 0
@@ -22,6 +22,7 @@ bool JsonReader::initialize(AllData& alldata){
 }
 
 bool JsonReader::readDefinitions(AllData& alldata){
+    auto& strings = alldata.definitions.strings;
 
     // parse definitions::regions
     const rapidjson::Value& regions = document["Definitions"]["regions"];
@@ -29,10 +30,10 @@ bool JsonReader::readDefinitions(AllData& alldata){
     for(rapidjson::SizeType i = 0; i < regions.Size(); ++i){
         uint64_t region_id = regions[i]["region_id"].GetUint64();
         definitions::Region region{
-            regions[i]["name"].GetString(),
+            strings.intern(regions[i]["name"].GetString()),
             regions[i]["paradigm_id"].GetUint(),
             regions[i]["source_line"].GetUint(),
-            regions[i]["file_name"].GetString()
+            strings.intern(regions[i]["file_name"].GetString())
         };
         alldata.definitions.regions.add(region_id, region);
     }
@@ -44,14 +45,14 @@ bool JsonReader::readDefinitions(AllData& alldata){
         uint64_t metric_id = metric["metric_id"].GetUint64();
 
         definitions::Metric new_metric {
-            metric["name"].GetString(),
-            metric["description"].GetString(),
+            strings.intern(metric["name"].GetString()),
+            strings.intern(metric["description"].GetString()),
             static_cast<MetricType> (metric["metricType"].GetUint()),
             static_cast<MetricMode> (metric["metricMode"].GetUint()),
             static_cast<MetricDataType> (metric["type"].GetUint()),
             static_cast<MetricBase> (metric["base"].GetUint()),
             metric["exponent"].GetInt64(),
-            metric["unit"].GetString(),
+            strings.intern(metric["unit"].GetString()),
             metric["allowed"].GetBool()
         };
 
@@ -105,7 +106,7 @@ bool JsonReader::readDefinitions(AllData& alldata){
     const rapidjson::Value& iohandles = document["Definitions"]["iohandles"];
     for(const auto& iohandle : iohandles.GetArray()){
         uint64_t    iohandle_id    = std::stoll(iohandle.MemberBegin()->name.GetString());
-        std::string name           = iohandle.MemberBegin()->value["name"].GetString();
+        auto        name           = strings.intern(iohandle.MemberBegin()->value["name"].GetString());
         uint32_t    io_paradigm    = iohandle.MemberBegin()->value["io_paradigm"].GetUint();
         uint64_t    file           = iohandle.MemberBegin()->value["file"].GetUint64();
         uint64_t    parent         = iohandle.MemberBegin()->value["parent"].GetUint64();
@@ -138,18 +139,17 @@ bool JsonReader::readDefinitions(AllData& alldata){
     return true;
 }
 
-void read_node(const rapidjson::Value& node, AllData& alldata, std::shared_ptr<tree_node> parent){
+void read_node(const rapidjson::Value& node, AllData& alldata, tree_node* parent){
 
     uint64_t function_id = node["region_id"].GetUint64();
-    auto tmp_node        = std::make_shared<tree_node>(function_id);
-    tmp_node->parent     = parent.get();
+    auto tmp_node        = alldata.call_path_tree.insert_node(function_id, parent);
+    assert(tmp_node != nullptr);
 
     // parse node_data
 
     for(auto& data : node["node_data"].GetArray()){
 
         uint64_t location_id = data["location_id"].GetUint64();
-        NodeData& node_data  = tmp_node->node_data[location_id];
 
         const rapidjson::Value& f_data = data["f_data"];
         tmp_node->add_data(
@@ -207,9 +207,6 @@ void read_node(const rapidjson::Value& node, AllData& alldata, std::shared_ptr<t
 
     tmp_node->has_p2p    = node["has_p2p"].GetBool();
     tmp_node->has_collop = node["has_collop"].GetBool();
-
-
-    alldata.call_path_tree.insert_node(tmp_node);
 }
 
 bool JsonReader::readEvents(AllData& alldata){
@@ -284,10 +281,6 @@ bool JsonReader::readStatistics(AllData& alldata){
     alldata.metaData.myRank          = document["meta_data_profiler"]["myRank"].GetUint();
     alldata.metaData.numRanks        = document["meta_data"]["numRanks"].GetUint();
     alldata.params.input_file_name   = document["meta_data"]["input_file_name"].GetString();
-    #ifdef OTFPROFILER_MPI
-        alldata.metaData.packBufferSize = document["meta_data_profiler"]["packBufferSize"].GetUint64();
-        alldata.metaData.packBuffer     = document["meta_data_profiler"]["packBuffer"].GetUint64();
-    #endif
     return true;
 }
 
@@ -0,0 +1,202 @@
+/*
+ This is part of the OTF-Profiler. Copyright by ZIH, TU Dresden 2016-2018.
+ Authors: Maximillian Neumann, Denis Hünich, Jens Doleschal
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "data_tree.h"
+#include "metric_intervals.h"
+
+using namespace std;
+
+void SampledMetrics::add_member(uint64_t class_id, uint8_t position, uint64_t metric_id, MetricMode mode,
+                                MetricDataType type) {
+    if (class_id >= classes.size())
+        classes.resize(class_id + 1);
+
+    bool absolute = mode == MetricMode::ABSOLUTE_POINT || mode == MetricMode::ABSOLUTE_LAST ||
+                    mode == MetricMode::ABSOLUTE_NEXT;
+
+    classes[class_id].push_back(
+        {position, metric_id, mode, absolute ? MetricDataType::DOUBLE : type, static_cast<uint32_t>(num++)});
+    metric_ids.insert(metric_id);
+}
+
+static double to_double(MetricDataType type, MetricData::Data value) {
+    switch (type) {
+        case MetricDataType::UINT64:
+            return static_cast<double>(value.u);
+        case MetricDataType::INT64:
+            return static_cast<double>(value.s);
+        case MetricDataType::DOUBLE:
+            return value.d;
+    }
+
+    return 0;
+}
+
+void MetricIntervals::reset(const SampledMetrics* _metrics, uint64_t location_id, uint64_t _timer_resolution) {
+    metrics          = (_metrics != nullptr && !_metrics->empty()) ? _metrics : nullptr;
+    location         = location_id;
+    timer_resolution = _timer_resolution != 0 ? _timer_resolution : 1;
+    first_seq        = 0;
+    next_seq         = 0;
+
+    states.assign(metrics != nullptr ? metrics->num_members() : 0, MemberState{});
+    segments.resize(metrics != nullptr ? capacity : 0);
+}
+
+void MetricIntervals::set_node(uint64_t time, tree_node* node) {
+    // several enter/leave at the same time -> only the last node matters
+    if (next_seq > first_seq && at(next_seq - 1).start == time) {
+        at(next_seq - 1).node = node;
+        return;
+    }
+
+    if (next_seq - first_seq == capacity) {
+        trim();
+
+        if (next_seq - first_seq == capacity) {
+            // still full -> merge the oldest segment into the next one
+            at(first_seq + 1).start = at(first_seq).start;
+            ++first_seq;
+        }
+    }
+
+    at(next_seq++) = {time, node};
+}
+
+// drops the segments that every member has already passed
+void MetricIntervals::trim() {
+    uint64_t min_seq = next_seq - 1;
+
+    for (const auto& state : states)
+        if (state.has_prev && state.seq < min_seq)
+            min_seq = state.seq;
+
+    first_seq = max(first_seq, min_seq);
+}
+
+void MetricIntervals::add(tree_node* node, const SampledMetrics::Member& member, double amount) {
+    auto& metdata = node->metric(location, member.metric_id, member.result_type);
+
+    switch (member.result_type) {
+        case MetricDataType::UINT64:
+            // a decreasing counter gives a negative amount -> wraps like the difference of the values
+            metdata.data_incl += static_cast<uint64_t>(static_cast<int64_t>(amount));
+            metdata.data_excl += static_cast<uint64_t>(static_cast<int64_t>(amount));
+            break;
+        case MetricDataType::INT64:
+            metdata.data_incl += static_cast<int64_t>(amount);
+            metdata.data_excl += static_cast<int64_t>(amount);
+            break;
+        case MetricDataType::DOUBLE:
+            metdata.data_incl += amount;
+            metdata.data_excl += amount;
+            break;
+    }
+}
+
+// splits amount over the segments in (from, to], proportional to their time
+void MetricIntervals::attribute(const SampledMetrics::Member& member, const MemberState& state, uint64_t from,
+                                uint64_t to, double amount) {
+    if (next_seq == first_seq || amount == 0)
+        return;
+
+    if (to <= from) {
+        if (at(next_seq - 1).node != nullptr)
+            add(at(next_seq - 1).node, member, amount);
+        return;
+    }
+
+    bool   integral = member.result_type != MetricDataType::DOUBLE;
+    double duration = static_cast<double>(to - from);
+    double assigned = 0;
+    double covered  = 0;
+
+    for (uint64_t seq = max(state.seq, first_seq); seq < next_seq; ++seq) {
+        auto start = max(at(seq).start, from);
+        auto end   = seq + 1 < next_seq ? min(at(seq + 1).start, to) : to;
+
+        if (end <= start)
+            continue;
+
+        covered += static_cast<double>(end - start);
+
+        // integer metrics -> round the running sum, the parts add up to the rounded amount
+        double share = integral ? round(amount * covered / duration) - assigned
+                                : amount * covered / duration - assigned;
+        assigned += share;
+
+        if (at(seq).node != nullptr && share != 0)
+            add(at(seq).node, member, share);
+    }
+}
+
+void MetricIntervals::sample(const SampledMetrics::Member& member, uint64_t time, MetricDataType type,
+                             MetricData::Data value) {
+    auto&  state   = states[member.index];
+    double current = to_double(type, value);
+
+    switch (member.mode) {
+        case MetricMode::ACCUMULATED_START:
+        case MetricMode::ACCUMULATED_POINT:
+            if (state.has_prev) {
+                // difference in the value type -> no precision loss for large counters
+                double delta = current - state.prev_value;
+                if (type == MetricDataType::UINT64)
+                    delta = static_cast<double>(static_cast<int64_t>(value.u - state.prev_raw.u));
+                else if (type == MetricDataType::INT64)
+                    delta = static_cast<double>(value.s - state.prev_raw.s);
+
+                attribute(member, state, state.prev_time, time, delta);
+            }
+            break;
+
+        case MetricMode::ACCUMULATED_LAST:
+        case MetricMode::RELATIVE_LAST:
+            if (state.has_prev)
+                attribute(member, state, state.prev_time, time, current);
+            break;
+
+        case MetricMode::ABSOLUTE_LAST:
+            if (state.has_prev)
+                attribute(member, state, state.prev_time, time,
+                          current * (time - state.prev_time) / timer_resolution);
+            break;
+
+        case MetricMode::ABSOLUTE_POINT:
+            if (state.has_prev)
+                attribute(member, state, state.prev_time, time,
+                          (current + state.prev_value) / 2 * (time - state.prev_time) / timer_resolution);
+            break;
+
+        case MetricMode::ACCUMULATED_NEXT:
+        case MetricMode::RELATIVE_NEXT:
+            if (state.has_next)
+                attribute(member, state, state.prev_time, time, state.next_value);
+            state.next_value = current;
+            state.has_next   = true;
+            break;
+
+        case MetricMode::ABSOLUTE_NEXT:
+            if (state.has_next)
+                attribute(member, state, state.prev_time, time,
+                          state.next_value * (time - state.prev_time) / timer_resolution);
+            state.next_value = current;
+            state.has_next   = true;
+            break;
+
+        case MetricMode::RELATIVE_POINT:
+            attribute(member, state, time, time, current);
+            break;
+    }
+
+    state.has_prev   = true;
+    state.prev_time  = time;
+    state.prev_value = current;
+    state.prev_raw   = value;
+    state.seq        = next_seq > first_seq ? next_seq - 1 : next_seq;
+}
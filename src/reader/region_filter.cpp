@@ -0,0 +1,93 @@
+/*
+ This is part of the OTF-Profiler. Copyright by ZIH, TU Dresden 2016-2018.
+ Authors: Maximillian Neumann, Denis Hünich, Jens Doleschal
+*/
+
+#include <fnmatch.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "region_filter.h"
+
+using namespace std;
+
+bool RegionFilter::load(const string& file_name) {
+    ifstream file(file_name);
+    if (!file) {
+        cerr << "ERROR: Could not open filter file '" << file_name << "'" << endl;
+        return false;
+    }
+
+    enum class Block { NONE, REGIONS, FILES } block = Block::NONE;
+
+    bool   exclude     = true;
+    bool   mangled     = false;
+    bool   have_action = false;
+    string line;
+    size_t line_number = 0;
+
+    while (getline(file, line)) {
+        ++line_number;
+        line = line.substr(0, line.find('#'));
+
+        istringstream tokens(line);
+        string        token;
+        while (tokens >> token) {
+            if (token == "SCOREP_REGION_NAMES_BEGIN" || token == "SCOREP_FILE_NAMES_BEGIN") {
+                if (block != Block::NONE)
+                    break;
+
+                block       = token == "SCOREP_REGION_NAMES_BEGIN" ? Block::REGIONS : Block::FILES;
+                have_action = false;
+            } else if (token == "SCOREP_REGION_NAMES_END" || token == "SCOREP_FILE_NAMES_END") {
+                if (block != (token == "SCOREP_REGION_NAMES_END" ? Block::REGIONS : Block::FILES))
+                    break;
+
+                block = Block::NONE;
+            } else if (block == Block::NONE) {
+                break;
+            } else if (token == "EXCLUDE" || token == "INCLUDE") {
+                exclude     = token == "EXCLUDE";
+                mangled     = false;
+                have_action = true;
+            } else if (token == "MANGLED" && block == Block::REGIONS && have_action) {
+                mangled = true;
+            } else if (have_action) {
+                (block == Block::REGIONS ? region_rules : file_rules).push_back({exclude, mangled, token});
+            } else {
+                break;
+            }
+
+            token.clear();
+        }
+
+        if (!token.empty()) {
+            cerr << "ERROR: Unexpected '" << token << "' in filter file '" << file_name << "' line " << line_number
+                 << endl;
+            return false;
+        }
+    }
+
+    if (block != Block::NONE) {
+        cerr << "ERROR: Missing end of block in filter file '" << file_name << "'" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool RegionFilter::excluded_by(const vector<Rule>& rules, const string& name, const string& mangled_name) {
+    // last match wins -> search backwards
+    for (auto rule = rules.rbegin(); rule != rules.rend(); ++rule) {
+        const auto& candidate = rule->mangled ? mangled_name : name;
+        if (fnmatch(rule->pattern.c_str(), candidate.c_str(), 0) == 0)
+            return rule->exclude;
+    }
+
+    return false;
+}
+
+bool RegionFilter::excludes(const string& name, const string& mangled_name, const string& file) const {
+    return excluded_by(file_rules, file, file) || excluded_by(region_rules, name, mangled_name);
+}
@@ -4,457 +4,654 @@
 */
 
 #include <mpi.h>
+#include <algorithm>
 #include <cmath>
+#include <limits>
 #include <sstream>
+#include <unordered_map>
 
 #include "reduce_data.h"
 
 using namespace std;
 
-/* mapping and data deques for serialisation */
-static map<uint64_t, pair<uint64_t, uint64_t>>                 mapping;
-static deque<tuple<uint64_t, uint64_t, FunctionData*>>         f_data;
-static deque<tuple<uint64_t, uint64_t, MessageData*>>          m_data;
-static deque<tuple<uint64_t, uint64_t, CollopData*>>           c_data;
-static deque<tuple<uint64_t, uint64_t, uint64_t, MetricData*>> met_data;
-
-/* fence between statistics parts within the buffer for consistency checking */
-enum { FENCE = 0xDEADBEEF };
+/* bytes of a chunk, a large tree is sent in several chunks */
+static const size_t CHUNK_BYTES = 64 * 1024 * 1024;
 
 enum {
 
-    PACK_TOTAL_SIZE    = 0,
-    PACK_MAPPING       = 1,
-    PACK_FUNCTION_DATA = 2,
-    PACK_MESSAGE_DATA  = 3,
-    PACK_COLLOP_DATA   = 4,
-    PACK_METRIC_DATA   = 5,
-    PACK_NUM_PACKS     = 6
+    PAYLOAD_NODES     = 0,
+    PAYLOAD_FUNCTIONS = 1,
+    PAYLOAD_MESSAGES  = 2,
+    PAYLOAD_COLLOPS   = 3,
+    PAYLOAD_METRICS   = 4,
+    PAYLOAD_SECTIONS  = 5,
+    // header of a chunk: sizes of all sections and whether more chunks follow
+    HEADER_MORE = 5,
+    HEADER_SIZE = 6
 
 };
 
-/* pack the local alldata into a buffer, return buffer */
-static char* pack_worker_data(AllData& alldata, uint32_t sizes[PACK_NUM_PACKS]) {
-    uint64_t fence      = FENCE;
-    uint32_t num_fences = 1;
+/*
+every entry of a section is a fixed number of 64 bit values -> MPI converts them between heterogeneous ranks,
+metric values are transferred as their 64 bit pattern (doubles have the width and byte order of uint64_t)
+*/
+template <typename Entry>
+static MPI_Datatype entry_type() {
+    static_assert(sizeof(Entry) % sizeof(uint64_t) == 0, "payload entries consist of 64 bit values");
 
-    /* get the sizes of all parts that need to be transmitted */
+    MPI_Datatype type;
+    MPI_Type_contiguous(sizeof(Entry) / sizeof(uint64_t), MPI_UINT64_T, &type);
 
-    for (uint32_t i = 1; i < PACK_NUM_PACKS; i++) {
-        sizes[i] = 0;
-    }
+    return type;
+}
 
-    sizes[PACK_MAPPING] = mapping.size();
-    num_fences++;
+template <typename Entry>
+static void add_section(vector<Entry>& section, MPI_Datatype types[], int lengths[], MPI_Aint displacements[],
+                        int& num) {
+    if (section.empty())
+        return;
 
-    sizes[PACK_FUNCTION_DATA] = f_data.size();
-    num_fences++;
+    assert(section.size() <= static_cast<size_t>(numeric_limits<int>::max()));
 
-    sizes[PACK_MESSAGE_DATA] = m_data.size();
-    num_fences++;
+    types[num]   = entry_type<Entry>();
+    lengths[num] = static_cast<int>(section.size());
+    MPI_Get_address(section.data(), &displacements[num]);
+    ++num;
+}
 
-    sizes[PACK_COLLOP_DATA] = c_data.size();
-    num_fences++;
+/* one datatype describing all sections at their addresses -> sent and received from MPI_BOTTOM without copies */
+static MPI_Datatype payload_type(tree_payload& data) {
+    MPI_Datatype types[PAYLOAD_SECTIONS];
+    int          lengths[PAYLOAD_SECTIONS];
+    MPI_Aint     displacements[PAYLOAD_SECTIONS];
+    int          num = 0;
 
-    sizes[PACK_METRIC_DATA] = met_data.size();
-    num_fences++;
+    add_section(data.nodes, types, lengths, displacements, num);
+    add_section(data.functions, types, lengths, displacements, num);
+    add_section(data.messages, types, lengths, displacements, num);
+    add_section(data.collops, types, lengths, displacements, num);
+    add_section(data.metrics, types, lengths, displacements, num);
 
-    /* get bytesize multiplying all pieces */
-    uint32_t bytesize = 0;
-    int      s1, s2;
+    MPI_Datatype type;
+    MPI_Type_create_struct(num, lengths, displacements, types, &type);
+    MPI_Type_commit(&type);
 
-    MPI_Pack_size(num_fences, MPI_LONG_LONG_INT, MPI_COMM_WORLD, &s1);
-    bytesize += s1;
+    for (int i = 0; i < num; ++i)
+        MPI_Type_free(&types[i]);
 
-    MPI_Pack_size(sizes[PACK_MAPPING] * 3, MPI_LONG_LONG_INT, MPI_COMM_WORLD, &s1);
-    bytesize += s1;
+    return type;
+}
 
-    MPI_Pack_size(sizes[PACK_FUNCTION_DATA] * 3, MPI_LONG_LONG_INT, MPI_COMM_WORLD, &s1);
-    MPI_Pack_size(sizes[PACK_FUNCTION_DATA] * 2, MPI_DOUBLE, MPI_COMM_WORLD, &s2);
-    bytesize += s1 + s2;
+/*
+chunk of a pipelined transfer: header and data are sent and received non-blocking, two chunks are in flight at a time
+-> serialization (sender) and unpacking (receiver) of one chunk overlap the transfer of the other one
+*/
+struct chunk_transfer {
+    tree_payload payload;
+    uint64_t     header[HEADER_SIZE];
+    MPI_Request  requests[2] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};  // header, data
+    MPI_Datatype type        = MPI_DATATYPE_NULL;
+};
 
-    MPI_Pack_size(sizes[PACK_MESSAGE_DATA] * 6, MPI_LONG_LONG_INT, MPI_COMM_WORLD, &s1);
-    bytesize += s1;
+static chunk_transfer chunks[2];
 
-    MPI_Pack_size(sizes[PACK_COLLOP_DATA] * 6, MPI_LONG_LONG_INT, MPI_COMM_WORLD, &s1);
-    bytesize += s1;
+/* waits for the request(s) of a chunk, the time counts as idle */
+static void wait_chunk(chunk_transfer& chunk, int first, int count, double& idle) {
+    double start = MPI_Wtime();
+    MPI_Waitall(count, chunk.requests + first, MPI_STATUSES_IGNORE);
+    idle += MPI_Wtime() - start;
 
-    MPI_Pack_size(sizes[PACK_METRIC_DATA] * 7, MPI_LONG_LONG_INT, MPI_COMM_WORLD, &s1);
-    bytesize += s1;
+    if (first + count == 2 && chunk.type != MPI_DATATYPE_NULL)
+        MPI_Type_free(&chunk.type);
+}
 
-    /* get the buffer */
-    sizes[PACK_TOTAL_SIZE] = bytesize;
-    char* buffer           = alldata.metaData.guaranteePackBuffer(bytesize);
+/* send the local tree to peer, chunk by chunk -> returns the number of bytes sent */
+static uint64_t send_worker_data(AllData& alldata, MPI_Comm comm, int peer, uint64_t& num_chunks, double& idle) {
+    tree_payload::cursor position;
+    uint64_t             bytes = 0;
+    bool                 more  = true;
 
-    /* pack parts */
-    int position = 0;
+    for (size_t k = 0; more; ++k) {
+        auto& chunk = chunks[k % 2];
 
-    /* extra check that doesn't cost too much */
-    MPI_Pack((void*)&fence, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
+        // buffer of the chunk before the previous one -> has to be sent completely
+        wait_chunk(chunk, 0, 2, idle);
 
-    /* pack mapping (three) */
-    {
-        for (auto it = mapping.begin(); it != mapping.end(); it++) {
-            MPI_Pack((void*)&it->first, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-            MPI_Pack((void*)&it->second.first, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-            MPI_Pack((void*)&it->second.second, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-        }
-    }
+        more = alldata.call_path_tree.serialize_data(chunk.payload, position, CHUNK_BYTES);
 
-    /* extra check that doesn't cost too much */
-    MPI_Pack((void*)&fence, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
+        const auto& data = chunk.payload;
+        chunk.header[PAYLOAD_NODES]     = data.nodes.size();
+        chunk.header[PAYLOAD_FUNCTIONS] = data.functions.size();
+        chunk.header[PAYLOAD_MESSAGES]  = data.messages.size();
+        chunk.header[PAYLOAD_COLLOPS]   = data.collops.size();
+        chunk.header[PAYLOAD_METRICS]   = data.metrics.size();
+        chunk.header[HEADER_MORE]       = more ? 1 : 0;
 
-    /* pack function data */
-    {
-        for (auto it = f_data.begin(); it != f_data.end(); it++) {
-            FunctionData tmp = *get<2>(*it);
-            MPI_Pack((void*)&get<0>(*it), 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-
-            MPI_Pack((void*)&get<1>(*it), 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-            MPI_Pack((void*)&tmp.count, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-            MPI_Pack((void*)&tmp.incl_time, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-            MPI_Pack((void*)&tmp.excl_time, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-        }
+        MPI_Isend(chunk.header, HEADER_SIZE, MPI_UINT64_T, peer, 4, comm, &chunk.requests[0]);
+
+        chunk.type = payload_type(chunk.payload);
+        MPI_Isend(MPI_BOTTOM, 1, chunk.type, peer, 5, comm, &chunk.requests[1]);
+
+        bytes += data.bytes();
+        ++num_chunks;
     }
 
-    /* extra check that doesn't cost too much */
-    MPI_Pack((void*)&fence, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
+    wait_chunk(chunks[0], 0, 2, idle);
+    wait_chunk(chunks[1], 0, 2, idle);
 
-    /* pack message data */
-    {
-        for (auto it = m_data.begin(); it != m_data.end(); it++) {
-            MessageData tmp = *get<2>(*it);
+    return bytes;
+}
 
-            MPI_Pack((void*)&get<0>(*it), 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
+/*
+receive the tree of peer chunk by chunk and add it to the local alldata -> returns the number of bytes received.
+Every chunk is added to the tree while the next one is transferred, existing paths are reused (no merge_tree).
+*/
+static uint64_t receive_worker_data(AllData& alldata, MPI_Comm comm, int peer, uint64_t& num_chunks, double& idle) {
+    // node ids of the peer -> nodes of the local tree
+    vector<tree_node*> nodes;
+    uint64_t           bytes    = 0;
+    chunk_transfer*    received = nullptr;
 
-            MPI_Pack((void*)&get<1>(*it), 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-            MPI_Pack((void*)&tmp.count_send, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-            MPI_Pack((void*)&tmp.count_recv, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-            MPI_Pack((void*)&tmp.bytes_send, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-            MPI_Pack((void*)&tmp.bytes_recv, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-        }
-    }
+    MPI_Irecv(chunks[0].header, HEADER_SIZE, MPI_UINT64_T, peer, 4, comm, &chunks[0].requests[0]);
 
-    /* extra check that doesn't cost too much */
-    MPI_Pack((void*)&fence, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
+    for (size_t k = 0;; ++k) {
+        auto& chunk = chunks[k % 2];
+        auto& next  = chunks[(k + 1) % 2];
 
-    /* pack collop data */
-    {
-        for (auto it = c_data.begin(); it != c_data.end(); it++) {
-            CollopData tmp = *get<2>(*it);
+        wait_chunk(chunk, 0, 1, idle);
 
-            MPI_Pack((void*)&get<0>(*it), 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-            MPI_Pack((void*)&get<1>(*it), 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
+        auto& data = chunk.payload;
+        data.nodes.resize(chunk.header[PAYLOAD_NODES]);
+        data.functions.resize(chunk.header[PAYLOAD_FUNCTIONS]);
+        data.messages.resize(chunk.header[PAYLOAD_MESSAGES]);
+        data.collops.resize(chunk.header[PAYLOAD_COLLOPS]);
+        data.metrics.resize(chunk.header[PAYLOAD_METRICS]);
 
-            MPI_Pack((void*)&tmp.count_send, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-            MPI_Pack((void*)&tmp.count_recv, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-            MPI_Pack((void*)&tmp.bytes_send, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-            MPI_Pack((void*)&tmp.bytes_recv, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-        }
+        chunk.type = payload_type(data);
+        MPI_Irecv(MPI_BOTTOM, 1, chunk.type, peer, 5, comm, &chunk.requests[1]);
+
+        bool more = chunk.header[HEADER_MORE] != 0;
+        if (more)
+            MPI_Irecv(next.header, HEADER_SIZE, MPI_UINT64_T, peer, 4, comm, &next.requests[0]);
+
+        // previous chunk (buffer of next) while this one is transferred
+        if (received != nullptr)
+            alldata.call_path_tree.deserialize_data(received->payload, nodes);
+
+        wait_chunk(chunk, 1, 1, idle);
+
+        received = &chunk;
+        bytes += data.bytes();
+        ++num_chunks;
+
+        if (!more)
+            break;
     }
 
-    /* extra check that doesn't cost too much */
-    MPI_Pack((void*)&fence, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
+    alldata.call_path_tree.deserialize_data(received->payload, nodes);
 
-    /* pack metrics (counter) data */
-    {
-        for (auto it = met_data.begin(); it != met_data.end(); it++) {
-            MetricData tmp = *get<3>(*it);
-
-            MPI_Pack((void*)&get<0>(*it), 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-            MPI_Pack((void*)&get<1>(*it), 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-            MPI_Pack((void*)&get<2>(*it), 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-
-            MPI_Pack((void*)&tmp.type, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-
-            switch (tmp.type) {
-                case MetricDataType::UINT64:
-                    MPI_Pack((void*)&tmp.data_incl, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-                    MPI_Pack((void*)&tmp.data_excl, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-                    break;
-                case MetricDataType::INT64:
-                    MPI_Pack((void*)&tmp.data_incl, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-                    MPI_Pack((void*)&tmp.data_excl, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
-                    break;
-                case MetricDataType::DOUBLE:
-                    MPI_Pack((void*)&tmp.data_incl, 1, MPI_DOUBLE, buffer, bytesize, &position, MPI_COMM_WORLD);
-                    MPI_Pack((void*)&tmp.data_excl, 1, MPI_DOUBLE, buffer, bytesize, &position, MPI_COMM_WORLD);
-                    break;
-            }
-        }
+    return bytes;
+}
+
+/* <parent path id, function id> -> path id */
+struct path_key_hash {
+    size_t operator()(const pair<uint64_t, uint64_t>& key) const {
+        return hash<uint64_t>()(key.first * 0x9e3779b97f4a7c15ull ^ key.second);
     }
+};
 
-    /* extra check that doesn't cost too much */
-    MPI_Pack((void*)&fence, 1, MPI_LONG_LONG_INT, buffer, bytesize, &position, MPI_COMM_WORLD);
+/* entries in messages of at most CHUNK_BYTES -> the int counts of MPI do not overflow for large trees */
+template <typename Entry>
+static void send_entries(const vector<Entry>& entries, MPI_Datatype type, int peer) {
+    uint64_t size = entries.size();
+    MPI_Send(&size, 1, MPI_UINT64_T, peer, 0, MPI_COMM_WORLD);
 
-    return buffer;
+    size_t step = CHUNK_BYTES / sizeof(Entry);
+    for (size_t first = 0; first < entries.size(); first += step)
+        MPI_Send(entries.data() + first, static_cast<int>(min(step, entries.size() - first)), type, peer, 0,
+                 MPI_COMM_WORLD);
 }
 
-/* prepare alldata for unpack, return buffer of sufficient size */
-static char* prepare_worker_data(AllData& alldata, uint32_t sizes[PACK_NUM_PACKS]) {
-    uint32_t bytesize = sizes[PACK_TOTAL_SIZE];
+template <typename Entry>
+static void receive_entries(vector<Entry>& entries, MPI_Datatype type, int peer) {
+    uint64_t size;
+    MPI_Recv(&size, 1, MPI_UINT64_T, peer, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    entries.resize(size);
 
-    return alldata.metaData.guaranteePackBuffer(bytesize);
+    size_t step = CHUNK_BYTES / sizeof(Entry);
+    for (size_t first = 0; first < entries.size(); first += step)
+        MPI_Recv(entries.data() + first, static_cast<int>(min(step, entries.size() - first)), type, peer, 0,
+                 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
 }
 
-/* unpack the received worker data and add it to the local alldata */
-static void unpack_worker_data(AllData& alldata, uint32_t sizes[PACK_NUM_PACKS]) {
-    data_tree tmp_tree;
-    /* <node_id, <parent_id, function_id, pointer on object> */
-    map<uint64_t, tuple<uint64_t, uint64_t, shared_ptr<tree_node>>> tmp_map;
+/*
+global call path ids, agreed on in the rounds of reduce_pairwise: every rank merges the distinct paths
+<function id, parent> of its peers into its own, rank 0 numbers the paths of all ranks and the ids go back down the
+same rounds -> a rank sends and receives only distinct paths, at most log2(ranks) times. Returns the global ids of
+the local nodes and num_paths, only rank 0 keeps all paths (parent = global id of the parent path).
+*/
+static vector<uint64_t> global_path_ids(AllData& alldata, vector<tree_payload::node_entry>& paths,
+                                        uint64_t& num_paths) {
+    auto& tree = alldata.call_path_tree;
+    tree.freeze();
+
+    unordered_map<pair<uint64_t, uint64_t>, uint64_t, path_key_hash> ids;
+
+    // adds entries (parents before children) to paths, merged gets the position of every entry in paths
+    auto merge = [&](const vector<tree_payload::node_entry>& entries, vector<uint64_t>& merged) {
+        merged.resize(entries.size());
 
-    uint64_t fence;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const auto& entry = entries[i];
+            auto parent = entry.parent != tree_payload::no_parent ? merged[entry.parent] : tree_payload::no_parent;
 
-    /* unpack parts */
-    int   position = 0;
-    char* buffer   = alldata.metaData.getPackBuffer();
+            auto it = ids.insert(make_pair(make_pair(parent, entry.function_id), paths.size()));
+            if (it.second)
+                paths.push_back({entry.function_id, parent});
 
-    /* extra check that doesn't cost too much */
-    fence = 0;
-    MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &fence, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-    assert(FENCE == fence);
+            merged[i] = it.first->second;
+        }
+    };
 
-    /* unpack mapping -> generate temporary tree */
+    vector<uint64_t> own;
     {
-        for (uint64_t i = 0; i < sizes[PACK_MAPPING]; i++) {
-            uint64_t id, function_id, parent_id;
+        vector<tree_payload::node_entry> local;
+        local.reserve(tree.traversal().size());
+        for (const auto& entry : tree.traversal())
+            local.push_back(
+                {entry.node->function_id, entry.parent != data_tree::npos ? entry.parent : tree_payload::no_parent});
+
+        paths.clear();
+        merge(local, own);
+    }
+
+    auto type = entry_type<tree_payload::node_entry>();
+    MPI_Type_commit(&type);
+
+    int                      rank = alldata.metaData.myRank;
+    int                      size = alldata.metaData.numRanks;
+    int                      up   = -1;
+    vector<int>              peers;
+    vector<vector<uint64_t>> merged;  // per peer: its path -> position in paths
 
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &id, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &function_id, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &parent_id, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
+    for (int round = 1; round < size; round <<= 1) {
+        int peer = rank ^ round;
+        if (peer >= size)
+            continue;
+
+        if (rank < peer) {
+            vector<tree_payload::node_entry> received;
+            receive_entries(received, type, peer);
 
-            tmp_map.insert(make_pair(id, make_tuple(function_id, parent_id, shared_ptr<tree_node>(nullptr))));
+            peers.push_back(peer);
+            merged.emplace_back();
+            merge(received, merged.back());
+        } else {
+            send_entries(paths, type, peer);
+            up = peer;
+            break;
         }
+    }
 
-        // generate tree out of mapping AND add pointer to the respective node to the mapping
-        tmp_tree = data_tree(tmp_map);
+    MPI_Type_free(&type);
+    ids = decltype(ids)();
+
+    // global id of every path of this rank, rank 0 numbers them by position
+    vector<uint64_t> global;
+    if (up != -1) {
+        receive_entries(global, MPI_UINT64_T, up);
+        paths = vector<tree_payload::node_entry>();
+    } else {
+        global.resize(paths.size());
+        for (size_t i = 0; i < global.size(); ++i)
+            global[i] = i;
+    }
 
-        /* extra check that doesn't cost too much */
-        fence = 0;
-        MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &fence, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-        assert(FENCE == fence);
+    for (size_t p = 0; p < peers.size(); ++p) {
+        for (auto& id : merged[p])
+            id = global[id];
+        send_entries(merged[p], MPI_UINT64_T, peers[p]);
     }
 
-    /* unpack function data -> add it to the temporary tree */
-    {
-        for (uint64_t i = 0; i < sizes[PACK_FUNCTION_DATA]; i++) {
-            uint64_t id, rank, count, incl, excl;
-
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &id, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &rank, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &count, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &incl, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &excl, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-
-            /*  IMPORTANT: tmp_map.find( id ) --- find node in mapping
-             *  ->second --- get pointer to node in tree
-             *  ->m_data.insert() --- insert data in node-data-container
-             *  -----> insert is without checks for existence because an analysis rank is working on
-             * trace ranks exclusivly
-             *  that means if analysis rank 0 has trace ranks 0-3 he does not have any clue of trace
-             * rank 4-n so an insert of
-             *  rank 4-n is safe without testing for the existence of data
-             */
-
-            get<2>(tmp_map.find(id)->second)->node_data.insert(make_pair(rank, FunctionData{count, incl, excl}));
+    for (auto& id : own)
+        id = global[id];
+
+    num_paths = global.size();
+    MPI_Bcast(&num_paths, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+
+    return own;
+}
+
+/* section of all ranks at rank 0, sizes per rank from the gathered headers */
+template <typename Entry>
+static void gather_section(vector<Entry>& local, vector<Entry>& gathered, const vector<uint64_t>& headers,
+                           int section, int num_ranks, bool root) {
+    vector<int> counts;
+    vector<int> displacements;
+
+    if (root) {
+        counts.resize(num_ranks);
+        displacements.resize(num_ranks);
+
+        size_t total = 0;
+        for (int r = 0; r < num_ranks; ++r) {
+            counts[r]        = static_cast<int>(headers[r * HEADER_SIZE + section]);
+            displacements[r] = static_cast<int>(total);
+            total += counts[r];
         }
 
-        /* extra check that doesn't cost too much */
-        fence = 0;
-        MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &fence, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-        assert(FENCE == fence);
+        gathered.resize(total);
     }
 
-    /* unpack message data */
-    {
-        for (uint64_t i = 0; i < sizes[PACK_MESSAGE_DATA]; i++) {
-            uint64_t id, rank, count_send, count_recv, bytes_send, bytes_recv;
+    auto type = entry_type<Entry>();
+    MPI_Type_commit(&type);
+    MPI_Gatherv(local.data(), static_cast<int>(local.size()), type, gathered.data(), counts.data(),
+                displacements.data(), type, 0, MPI_COMM_WORLD);
+    MPI_Type_free(&type);
+}
+
+template <typename Entry>
+static void to_global(vector<Entry>& section, const vector<uint64_t>& ids) {
+    for (auto& entry : section)
+        entry.node = ids[entry.node];
+}
+
+/*
+reduction with global call path ids: instead of log2(ranks) rounds of temporary trees and merge_tree, the rows of all
+ranks are gathered at rank 0 in rounds of at most CHUNK_BYTES and added directly to the nodes of their global path
+*/
+static bool ReduceDataGlobalPaths(AllData& alldata) {
+    int  num_ranks = alldata.metaData.numRanks;
+    bool root      = alldata.metaData.myRank == 0;
+
+    vector<tree_payload::node_entry> paths;
+    uint64_t                         num_paths;
+    auto                             ids = global_path_ids(alldata, paths, num_paths);
+
+    ostringstream msg;
+    msg << " " << num_paths << " global call paths";
+    alldata.verbosePrint(1, true, msg.str());
+
+    // global path id -> node of the tree at rank 0
+    vector<tree_node*> nodes;
+    tree_payload       gathered;
+
+    if (root) {
+        gathered.nodes.swap(paths);
+        alldata.call_path_tree.deserialize_data(gathered, nodes);
+        gathered.nodes.clear();
+    }
+    paths = vector<tree_payload::node_entry>();
+
+    auto&                payload = chunks[0].payload;
+    tree_payload::cursor position;
+    vector<uint64_t>     headers(root ? num_ranks * HEADER_SIZE : 0);
+    bool                 pending    = !root;
+    uint64_t             bytes      = 0;
+    uint64_t             num_chunks = 0;
+    int                  more;
+
+    do {
+        payload.clear();
+
+        if (pending) {
+            pending = alldata.call_path_tree.serialize_data(payload, position, CHUNK_BYTES / num_ranks);
+
+            // the paths are known already -> only the rows are sent
+            payload.nodes.clear();
+            to_global(payload.functions, ids);
+            to_global(payload.messages, ids);
+            to_global(payload.collops, ids);
+            to_global(payload.metrics, ids);
+        }
 
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &id, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
+        uint64_t header[HEADER_SIZE] = {0,
+                                        payload.functions.size(),
+                                        payload.messages.size(),
+                                        payload.collops.size(),
+                                        payload.metrics.size(),
+                                        pending ? 1u : 0u};
 
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &rank, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &count_send, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &count_recv, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &bytes_send, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &bytes_recv, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
+        MPI_Gather(header, HEADER_SIZE, MPI_UINT64_T, headers.data(), HEADER_SIZE, MPI_UINT64_T, 0, MPI_COMM_WORLD);
 
-            // analogous to unpack function data
-            get<2>(tmp_map.find(id)->second)
-                ->add_data(rank, MessageData{count_send, count_recv, bytes_send, bytes_recv});
+        gather_section(payload.functions, gathered.functions, headers, PAYLOAD_FUNCTIONS, num_ranks, root);
+        gather_section(payload.messages, gathered.messages, headers, PAYLOAD_MESSAGES, num_ranks, root);
+        gather_section(payload.collops, gathered.collops, headers, PAYLOAD_COLLOPS, num_ranks, root);
+        gather_section(payload.metrics, gathered.metrics, headers, PAYLOAD_METRICS, num_ranks, root);
+
+        if (root) {
+            alldata.call_path_tree.deserialize_data(gathered, nodes);
+            bytes += gathered.bytes();
         }
+        ++num_chunks;
+
+        more = pending ? 1 : 0;
+        MPI_Allreduce(MPI_IN_PLACE, &more, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    } while (more != 0);
+
+    msg.str("");
+    msg << " received " << bytes << " bytes in " << num_chunks << " rounds";
+    alldata.verbosePrint(2, true, msg.str());
+
+    chunks[0] = chunk_transfer();
+
+    return true;
+}
+
+template <typename T>
+static MPI_Datatype value_type();
+
+template <>
+MPI_Datatype value_type<uint64_t>() {
+    return MPI_UINT64_T;
+}
+
+template <>
+MPI_Datatype value_type<double>() {
+    return MPI_DOUBLE;
+}
 
-        /* extra check that doesn't cost too much */
-        fence = 0;
-        MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &fence, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-        assert(FENCE == fence);
+static MPI_Op combine_op(TreeSummary::Combine combine) {
+    switch (combine) {
+        case TreeSummary::Combine::MIN:
+            return MPI_MIN;
+        case TreeSummary::Combine::MAX:
+            return MPI_MAX;
+        default:
+            return MPI_SUM;
     }
+}
 
-    /* unpack collop data */
-    {
-        for (uint64_t i = 0; i < sizes[PACK_COLLOP_DATA]; i++) {
-            uint64_t id, rank, count_send, count_recv, bytes_send, bytes_recv;
+/* reduces the paths [first, first + count) of a summary array, rank 0 keeps all paths and reduces in place */
+struct reduce_paths {
+    size_t first;
+    size_t count;
+    bool   root;
 
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &id, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
+    template <typename T>
+    void operator()(vector<T>& values, size_t width, TreeSummary::Combine combine) const {
+        if (width == 0)
+            return;
 
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &rank, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &count_send, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &count_recv, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &bytes_send, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &bytes_recv, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
+        assert(count * width <= static_cast<size_t>(numeric_limits<int>::max()));
 
-            // analogous to unpack function data
-            get<2>(tmp_map.find(id)->second)
-                ->add_data(rank, CollopData{count_send, count_recv, bytes_send, bytes_recv});
-        }
+        T*   data = values.data() + (root ? first * width : 0);
+        auto n    = static_cast<int>(count * width);
 
-        /* extra check that doesn't cost too much */
-        fence = 0;
-        MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &fence, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-        assert(FENCE == fence);
+        MPI_Reduce(root ? MPI_IN_PLACE : data, data, n, value_type<T>(), combine_op(combine), 0, MPI_COMM_WORLD);
     }
+};
+
+/*
+aggregate-only reduction for the summary outputs: every rank folds its locations into statistics per global call
+path and only those are reduced -> traffic and memory of rank 0 are O(paths) instead of O(paths * locations).
+The summary is reduced in blocks of paths of at most CHUNK_BYTES with MPI_Reduce.
+*/
+static bool ReduceSummary(AllData& alldata) {
+    bool  root = alldata.metaData.myRank == 0;
+    auto& tree = alldata.call_path_tree;
 
-    /* unpack metrics (counter) data */
+    vector<tree_payload::node_entry> paths;
+    uint64_t                         num_paths;
+    auto                             ids = global_path_ids(alldata, paths, num_paths);
 
-    {
-        for (uint64_t i = 0; i < sizes[PACK_METRIC_DATA]; i++) {
-            uint64_t       id, rank, metric_id;
-            MetricDataType type;
-
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &id, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &rank, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &metric_id, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-
-            MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &type, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-
-            switch (type) {
-                case MetricDataType::UINT64: {
-                    uint64_t value_incl, value_excl;
-                    MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &value_incl, 1, MPI_LONG_LONG_INT,
-                               MPI_COMM_WORLD);
-                    MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &value_excl, 1, MPI_LONG_LONG_INT,
-                               MPI_COMM_WORLD);
-                    get<2>(tmp_map.find(id)->second)
-                        ->add_data(rank, metric_id, MetricData{type, value_incl, value_excl});
-                    break;
-                }
-                case MetricDataType::DOUBLE: {
-                    double value_incl, value_excl;
-                    MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &value_incl, 1, MPI_DOUBLE, MPI_COMM_WORLD);
-                    MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &value_excl, 1, MPI_DOUBLE, MPI_COMM_WORLD);
-                    get<2>(tmp_map.find(id)->second)
-                        ->add_data(rank, metric_id, MetricData{type, value_incl, value_excl});
-                    break;
-                }
-                case MetricDataType::INT64: {
-                    int64_t value_incl, value_excl;
-                    MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &value_incl, 1, MPI_LONG_LONG_INT,
-                               MPI_COMM_WORLD);
-                    MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &value_excl, 1, MPI_LONG_LONG_INT,
-                               MPI_COMM_WORLD);
-                    get<2>(tmp_map.find(id)->second)
-                        ->add_data(rank, metric_id, MetricData{type, value_incl, value_excl});
-                    break;
-                }
-            }
+    // local nodes ordered by global id -> the nodes of a block are one after the other
+    vector<pair<uint64_t, size_t>> local(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i)
+        local[i] = make_pair(ids[i], i);
+    sort(local.begin(), local.end());
+
+    TreeSummary summary(alldata.definitions, root ? num_paths : 0);
+    if (root)
+        for (const auto& node : local)
+            summary.add(node.first, *tree.traversal()[node.second].node);
+
+    size_t block      = max<size_t>(1, CHUNK_BYTES / summary.path_bytes());
+    size_t num_blocks = 0;
+    auto   next       = local.begin();
+
+    for (size_t first = 0; first < num_paths; first += block, ++num_blocks) {
+        reduce_paths reduce{first, min(block, num_paths - first), root};
+
+        if (!root) {
+            summary.reset(reduce.count);
+
+            for (; next != local.end() && next->first < first + reduce.count; ++next)
+                summary.add(next->first - first, *tree.traversal()[next->second].node);
         }
 
-        /* extra check that doesn't cost too much */
-        fence = 0;
-        MPI_Unpack(buffer, sizes[PACK_TOTAL_SIZE], &position, &fence, 1, MPI_LONG_LONG_INT, MPI_COMM_WORLD);
-        assert(FENCE == fence);
+        summary.arrays(reduce);
     }
 
-    alldata.call_path_tree.merge_tree(tmp_tree);
-}
+    ostringstream msg;
+    msg << " summary of " << num_paths << " global call paths, " << num_paths * summary.path_bytes() << " bytes in "
+        << num_blocks << " blocks";
+    alldata.verbosePrint(2, true, msg.str());
 
-bool ReduceData(AllData& alldata) {
-    bool error = false;
+    if (!root)
+        return true;
 
-    assert(1 < alldata.metaData.numRanks);
+    // nodes for the paths of all ranks, the summary is indexed by their position in the traversal index
+    vector<tree_node*> nodes;
+    tree_payload       received;
+    received.nodes.swap(paths);
+    tree.deserialize_data(received, nodes);
+    tree.freeze();
 
-    alldata.verbosePrint(1, true, "reducing data");
+    vector<size_t> position(num_paths);
+    for (size_t path = 0; path < num_paths; ++path)
+        position[path] = nodes[path]->index;
 
-    /* implement reduction myself because MPI and C++ STL don't play with
-    each other */
+    alldata.summary = make_shared<TreeSummary>(summary.reordered(position, tree.traversal().size()));
+
+    return true;
+}
+
+/*
+pairwise reduction within comm: in every round a rank receives from the rank round above or sends to the rank round
+below and is done -> rank 0 of comm ends up with the data of all ranks of comm
+*/
+static void reduce_pairwise(AllData& alldata, MPI_Comm comm, const char* level, double& idle) {
+    int rank;
+    int size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
 
     /* how many rounds until master has all the data? */
-    uint32_t num_rounds = std::log2(alldata.metaData.numRanks);
+    uint32_t num_rounds = std::ceil(std::log2(size));
     uint32_t round_no   = 0;
-    uint32_t round      = 1;
-    while (round < alldata.metaData.numRanks) {
+    int      round      = 1;
+    while (round < size) {
         round_no++;
 
         ostringstream msg;
-        msg << " round " << round_no << " / " << num_rounds;
+        msg << " " << level << " round " << round_no << " / " << num_rounds;
         alldata.verbosePrint(1, true, msg.str());
 
-        uint32_t peer = alldata.metaData.myRank ^ round;
+        int peer = rank ^ round;
 
         /* if peer rank is not there, do nothing but go on */
-        if (peer >= alldata.metaData.numRanks) {
+        if (peer >= size) {
             round = round << 1;
             continue;
         }
 
         /* send to smaller peer, receive from larger one */
-        uint32_t sizes[PACK_NUM_PACKS];
-        char*    buffer;
+        uint64_t num_chunks = 0;
 
-        if (alldata.metaData.myRank < peer) {
-            MPI_Status status;
+        if (rank < peer) {
+            auto bytes = receive_worker_data(alldata, comm, peer, num_chunks, idle);
 
-            MPI_Recv(sizes, PACK_NUM_PACKS, MPI_UNSIGNED, peer, 4, MPI_COMM_WORLD, &status);
-
-            // DEBUG
-            // cout << "    round " << round << " recv " << peer << "--> " <<
-            // alldata.myRank << " with " <<
-            // sizes[PACK_TOTAL_SIZE] << " bytes, " <<
-            // sizes[PACK_FUNCTION] << ", " <<
-            // sizes[PACK_FUNCTION_DURATION] << ", " <<
-            // sizes[PACK_COUNTER] << ", " <<
-            // sizes[PACK_MSG_GROUP_PAIR] << "" << endl << flush;
+            msg << ": received " << bytes << " bytes in " << num_chunks << " chunks from " << level << " rank " << peer;
+            alldata.verbosePrint(2, false, msg.str());
 
-            buffer = prepare_worker_data(alldata, sizes);
+        } else {
+            auto bytes = send_worker_data(alldata, comm, peer, num_chunks, idle);
 
-            msg << ": receiving " << sizes[PACK_TOTAL_SIZE] << " bytes from rank " << peer;
+            msg << ": sent " << bytes << " bytes in " << num_chunks << " chunks to " << level << " rank " << peer;
             alldata.verbosePrint(2, false, msg.str());
 
-            MPI_Recv(buffer, sizes[PACK_TOTAL_SIZE], MPI_PACKED, peer, 5, MPI_COMM_WORLD, &status);
+            /* every work has to send off its data at most once,
+            after that, break from the collective reduction operation */
+            break;
+        }
 
-            unpack_worker_data(alldata, sizes);
+        round = round << 1;
+    }
+}
 
-        } else {
-            alldata.call_path_tree.serialize_data(mapping, f_data, m_data, c_data, met_data);
+bool ReduceData(AllData& alldata) {
+    bool error = false;
 
-            buffer = pack_worker_data(alldata, sizes);
+    assert(1 < alldata.metaData.numRanks);
 
-            // DEBUG
-            // cout << "    round " << round << " send " << alldata.myRank <<
-            //" --> " << peer << " with " <<
-            // sizes[PACK_TOTAL_SIZE] << " bytes, " <<
-            // sizes[PACK_FUNCTION] << ", " <<
-            // sizes[PACK_FUNCTION_DURATION] << ", " <<
-            // sizes[PACK_COUNTER] << ", " <<
-            // sizes[PACK_MSG_GROUP_PAIR] << "" << endl << flush;
+    alldata.verbosePrint(1, true, "reducing data");
 
-            msg << ": sending " << sizes[PACK_TOTAL_SIZE] << " bytes to rank " << peer;
-            alldata.verbosePrint(2, false, msg.str());
+    // only summary outputs -> statistics per call path instead of the data of every location
+    if (!alldata.params.create_cube && !alldata.params.data_dump && alldata.params.rank == -1)
+        return ReduceSummary(alldata);
 
-            MPI_Send(sizes, PACK_NUM_PACKS, MPI_UNSIGNED, peer, 4, MPI_COMM_WORLD);
+    if (alldata.params.global_paths)
+        return ReduceDataGlobalPaths(alldata);
 
-            MPI_Send(buffer, sizes[PACK_TOTAL_SIZE], MPI_PACKED, peer, 5, MPI_COMM_WORLD);
+    /* implement reduction myself because MPI and C++ STL don't play with
+    each other */
 
-            /* every work has to send off its data at most once,
-            after that, break from the collective reduction operation */
-            break;
-        }
+    /*
+    two levels: the ranks of a node reduce to their node leader first (shared memory transport), then only the node
+    leaders reduce over the network. World rank 0 is the leader of its node and rank 0 of the leaders.
+    */
+    MPI_Comm node_comm;
+    MPI_Comm leader_comm;
+    int      node_rank;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, alldata.metaData.myRank, MPI_INFO_NULL, &node_comm);
+    MPI_Comm_rank(node_comm, &node_rank);
+    MPI_Comm_split(MPI_COMM_WORLD, node_rank == 0 ? 0 : MPI_UNDEFINED, alldata.metaData.myRank, &leader_comm);
+
+    if (leader_comm != MPI_COMM_NULL) {
+        int num_nodes;
+        MPI_Comm_size(leader_comm, &num_nodes);
+        alldata.verbosePrint(1, true, " " + to_string(num_nodes) + " node(s)");
+    }
 
-        round = round << 1;
+    double start = MPI_Wtime();
+    double idle  = 0;
+
+    reduce_pairwise(alldata, node_comm, "node", idle);
+
+    if (leader_comm != MPI_COMM_NULL) {
+        reduce_pairwise(alldata, leader_comm, "inter-node", idle);
+        MPI_Comm_free(&leader_comm);
     }
 
-    alldata.metaData.freePackBuffer();
+    MPI_Comm_free(&node_comm);
+
+    ostringstream msg;
+    msg << "reduce: idle " << idle << " s of " << MPI_Wtime() - start << " s waiting on peers";
+    alldata.verbosePrint(2, false, msg.str());
+
+    chunks[0] = chunk_transfer();
+    chunks[1] = chunk_transfer();
 
     /* synchronize error indicator with workers */
     /*SyncError( alldata, error );*/
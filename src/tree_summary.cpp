@@ -0,0 +1,163 @@
+/*
+ This is part of the OTF-Profiler. Copyright by ZIH, TU Dresden 2016-2018.
+ Authors: Maximillian Neumann, Denis Hünich, Jens Doleschal
+*/
+
+#include "tree_summary.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "data_tree.h"
+
+using namespace std;
+
+TreeSummary::TreeSummary(const definitions::Definitions& definitions, size_t num_paths) {
+    // ascending ids -> the same fields on every rank
+    for (const auto& metric : definitions.metrics.get_all()) {
+        // sampled ABSOLUTE_* metrics are integrated over time -> double values
+        auto mode     = metric.second.metricMode;
+        bool absolute = mode == MetricMode::ABSOLUTE_POINT || mode == MetricMode::ABSOLUTE_LAST ||
+                        mode == MetricMode::ABSOLUTE_NEXT;
+        bool  integer = metric.second.type == MetricDataType::UINT64 && !absolute;
+        auto& width   = integer ? int_width : double_width;
+
+        metric_index[metric.first] = static_cast<uint32_t>(metric_fields.size());
+        metric_fields.push_back({metric.first, integer, static_cast<uint32_t>(width)});
+        width += 2;
+    }
+
+    reset(num_paths);
+}
+
+TreeSummary TreeSummary::of_tree(data_tree& tree, const definitions::Definitions& definitions) {
+    tree.freeze();
+
+    TreeSummary summary(definitions, tree.traversal().size());
+    for (size_t i = 0; i < tree.traversal().size(); ++i)
+        summary.add(i, *tree.traversal()[i].node);
+
+    return summary;
+}
+
+void TreeSummary::reset(size_t num_paths) {
+    locations_.assign(num_paths, 0);
+
+    int_sum.assign(num_paths * int_width, 0);
+    int_min.assign(num_paths * int_width, numeric_limits<uint64_t>::max());
+    int_max.assign(num_paths * int_width, 0);
+    int_sumsq.assign(num_paths * int_width, 0);
+
+    double_sum.assign(num_paths * double_width, 0);
+    double_min.assign(num_paths * double_width, numeric_limits<double>::infinity());
+    double_max.assign(num_paths * double_width, -numeric_limits<double>::infinity());
+    double_sumsq.assign(num_paths * double_width, 0);
+}
+
+size_t TreeSummary::path_bytes() const {
+    return sizeof(uint64_t) + int_width * (3 * sizeof(uint64_t) + sizeof(double)) + double_width * 4 * sizeof(double);
+}
+
+void TreeSummary::add_int(size_t i, uint64_t value) {
+    int_sum[i] += value;
+    int_min[i] = min(int_min[i], value);
+    int_max[i] = max(int_max[i], value);
+    int_sumsq[i] += static_cast<double>(value) * static_cast<double>(value);
+}
+
+void TreeSummary::add_double(size_t i, double value) {
+    double_sum[i] += value;
+    double_min[i] = min(double_min[i], value);
+    double_max[i] = max(double_max[i], value);
+    double_sumsq[i] += value * value;
+}
+
+static double to_double(MetricDataType type, MetricData::Data value) {
+    switch (type) {
+        case MetricDataType::UINT64:
+            return static_cast<double>(value.u);
+        case MetricDataType::INT64:
+            return static_cast<double>(value.s);
+        case MetricDataType::DOUBLE:
+            return value.d;
+    }
+
+    return 0;
+}
+
+void TreeSummary::add(size_t path, const tree_node& node) {
+    auto ints    = path * int_width;
+    auto doubles = path * double_width;
+
+    for (const auto& data : node.node_data) {
+        ++locations_[path];
+
+        const auto& f = data.second.f_data;
+        add_int(ints + COUNT, f.count);
+        add_int(ints + INCL_TIME, f.incl_time);
+        add_int(ints + EXCL_TIME, f.excl_time);
+
+        const auto& m = data.second.m_data;
+        add_int(ints + MSG_COUNT_SEND, m.count_send);
+        add_int(ints + MSG_COUNT_RECV, m.count_recv);
+        add_int(ints + MSG_BYTES_SEND, m.bytes_send);
+        add_int(ints + MSG_BYTES_RECV, m.bytes_recv);
+
+        const auto& c = data.second.c_data;
+        add_int(ints + COLLOP_COUNT_SEND, c.count_send);
+        add_int(ints + COLLOP_COUNT_RECV, c.count_recv);
+        add_int(ints + COLLOP_BYTES_SEND, c.bytes_send);
+        add_int(ints + COLLOP_BYTES_RECV, c.bytes_recv);
+
+        for (const auto& metric : data.second.metrics) {
+            auto it = metric_index.find(metric.first);
+            if (it == metric_index.end())
+                continue;
+
+            const auto& fields = metric_fields[it->second];
+            const auto& value  = metric.second;
+
+            if (fields.integer && value.type == MetricDataType::UINT64) {
+                add_int(ints + fields.incl, value.data_incl.u);
+                add_int(ints + fields.incl + 1, value.data_excl.u);
+            } else if (fields.integer) {
+                add_int(ints + fields.incl, static_cast<uint64_t>(to_double(value.type, value.data_incl)));
+                add_int(ints + fields.incl + 1, static_cast<uint64_t>(to_double(value.type, value.data_excl)));
+            } else {
+                add_double(doubles + fields.incl, to_double(value.type, value.data_incl));
+                add_double(doubles + fields.incl + 1, to_double(value.type, value.data_excl));
+            }
+        }
+    }
+}
+
+TreeSummary TreeSummary::reordered(const vector<size_t>& position, size_t num_paths) const {
+    TreeSummary summary;
+    summary.metric_fields = metric_fields;
+    summary.metric_index  = metric_index;
+    summary.int_width     = int_width;
+    summary.double_width  = double_width;
+    summary.reset(num_paths);
+
+    for (size_t path = 0; path < position.size(); ++path) {
+        auto to = position[path];
+
+        summary.locations_[to] = locations_[path];
+
+        for (size_t f = 0; f < int_width; ++f) {
+            summary.int_sum[to * int_width + f]   = int_sum[path * int_width + f];
+            summary.int_min[to * int_width + f]   = int_min[path * int_width + f];
+            summary.int_max[to * int_width + f]   = int_max[path * int_width + f];
+            summary.int_sumsq[to * int_width + f] = int_sumsq[path * int_width + f];
+        }
+
+        for (size_t f = 0; f < double_width; ++f) {
+            summary.double_sum[to * double_width + f]   = double_sum[path * double_width + f];
+            summary.double_min[to * double_width + f]   = double_min[path * double_width + f];
+            summary.double_max[to * double_width + f]   = double_max[path * double_width + f];
+            summary.double_sumsq[to * double_width + f] = double_sumsq[path * double_width + f];
+        }
+    }
+
+    return summary;
+}